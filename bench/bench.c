@@ -0,0 +1,133 @@
+#include "bench.h"
+#include "format.h"
+#include "device.h"
+#include "timebase.h"
+#include <stdbool.h>
+
+/**
+ * Benchmark runner, see bench.h
+ */
+
+extern const struct bench __bench_table_start[];
+extern const struct bench __bench_table_end[];
+extern const struct bench_check __bench_check_start[];
+extern const struct bench_check __bench_check_end[];
+
+extern int _write(int file, char *ptr, int len);
+
+static uint32_t samples[BENCH_MAX_REPEAT];
+
+#if defined(HOST)
+// Nanoseconds of the host's monotonic clock
+extern uint32_t host_cycles(void);
+#endif
+
+/**
+ * Cycle count, from SysTick where the DWT counter is missing
+ */
+static inline uint32_t now(bool dwt) {
+#if defined(HOST)
+  (void)dwt;
+  return host_cycles();
+#else
+  return dwt ? DWT->CYCCNT : (uint32_t)timebase_cycles();
+#endif
+}
+
+static void empty(uintptr_t arg) { (void)arg; }
+
+/**
+ * Times `repeat` calls of `run` into samples[]. With the DWT counter the
+ * calls run with interrupts masked, SysTick counting needs its interrupt.
+ */
+static void sample(bench_fn run, uintptr_t arg, uint32_t repeat, bool dwt) {
+  uint32_t primask = __get_PRIMASK();
+  for (uint32_t i = 0; i < repeat; i++) {
+    if (dwt) {
+      __disable_irq();
+    }
+    uint32_t start = now(dwt);
+    run(arg);
+    samples[i] = now(dwt) - start;
+    __set_PRIMASK(primask);
+  }
+}
+
+static void sort(uint32_t *values, uint32_t count) {
+  for (uint32_t i = 1; i < count; i++) {
+    uint32_t value = values[i];
+    uint32_t j = i;
+    for (; j > 0 && values[j - 1] > value; j--) {
+      values[j] = values[j - 1];
+    }
+    values[j] = value;
+  }
+}
+
+/**
+ * Runs every check, @return true if all passed
+ */
+static bool check_all(int fd) {
+  bool passed = true;
+  for (const struct bench_check *c = __bench_check_start;
+       c < __bench_check_end; c++) {
+    int failed = c->run();
+    char line[80];
+    int len = format_snprintf(line, sizeof(line),
+                              "{\"check\":\"%s\",\"failed\":%d}\n",
+                              c->name, failed);
+    if (len >= (int)sizeof(line)) {
+      len = sizeof(line) - 1;
+      line[len - 1] = '\n';
+    }
+    _write(fd, line, len);
+    passed &= failed == 0;
+  }
+  return passed;
+}
+
+int bench_run_all(int fd) {
+  bool dwt = timebase_has_cycle_counter();
+  bool passed = check_all(fd);
+
+  // Cost of timing an empty call, subtracted from every sample
+  sample(empty, 0, BENCH_MAX_REPEAT, dwt);
+  sort(samples, BENCH_MAX_REPEAT);
+  uint32_t overhead = samples[0];
+
+  int count = 0;
+  for (const struct bench *b = __bench_table_start; b < __bench_table_end;
+       b++) {
+    uint32_t repeat = b->repeat;
+    if (repeat == 0) {
+      repeat = 1;
+    } else if (repeat > BENCH_MAX_REPEAT) {
+      repeat = BENCH_MAX_REPEAT;
+    }
+
+    for (uint32_t i = 0; i < b->warmup; i++) {
+      b->run(b->arg);
+    }
+    sample(b->run, b->arg, repeat, dwt);
+    sort(samples, repeat);
+    for (uint32_t i = 0; i < repeat; i++) {
+      samples[i] = samples[i] > overhead ? samples[i] - overhead : 0;
+    }
+
+    char line[160];
+    int len = format_snprintf(
+        line, sizeof(line),
+        "{\"bench\":\"%s\",\"arg\":%lu,\"repeat\":%lu,\"min\":%lu,"
+        "\"median\":%lu,\"max\":%lu,\"hz\":%lu}\n",
+        b->name, (unsigned long)b->arg, (unsigned long)repeat,
+        (unsigned long)samples[0], (unsigned long)samples[repeat / 2],
+        (unsigned long)samples[repeat - 1], (unsigned long)SystemCoreClock);
+    if (len >= (int)sizeof(line)) {
+      len = sizeof(line) - 1;
+      line[len - 1] = '\n';
+    }
+    _write(fd, line, len);
+    count++;
+  }
+  return passed ? count : -1;
+}
@@ -0,0 +1,82 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Cycle-count microbenchmarks.
+ *
+ * BENCH() registers a function in the .bench_table section, bench_run_all()
+ * times every registered one with the DWT cycle counter: `warmup` untimed
+ * calls, then `repeat` timed calls reported as min/median/max cycles with
+ * the measurement overhead subtracted. Results are JSON lines:
+ *
+ *   {"bench":"name","arg":64,"repeat":32,"min":...,"median":...,"max":...,
+ *    "hz":180000000}
+ *
+ * BENCH_CHECK() registers a correctness check in .bench_check, run once
+ * before the benchmarks and reported as {"check":"name","failed":0}.
+ */
+
+#if !defined(BENCH_MAX_REPEAT)
+#define BENCH_MAX_REPEAT 64
+#endif
+
+typedef void (*bench_fn)(uintptr_t arg);
+
+struct bench {
+  const char *name;
+  bench_fn run;
+  // handed to every call, e.g. a buffer size
+  uintptr_t arg;
+  uint32_t warmup;
+  uint32_t repeat;
+};
+
+/**
+ * Registers `fn` as benchmark `name`, unique per translation unit, e.g.
+ * BENCH(memcpy_64, bench_memcpy, 64, 4, 32)
+ */
+#define BENCH(name, fn, arg, warmup, repeat)                                   \
+  static const struct bench bench_##name                                       \
+      __attribute__((used, section(".bench_table"))) = {                       \
+          #name, fn, arg, warmup, repeat}
+
+typedef int (*bench_check_fn)(void);
+
+struct bench_check {
+  const char *name;
+  // returns the number of failed cases
+  bench_check_fn run;
+};
+
+/**
+ * Registers `fn` as correctness check `name`, unique per translation unit
+ */
+#define BENCH_CHECK(name, fn)                                                  \
+  static const struct bench_check bench_check_##name                           \
+      __attribute__((used, section(".bench_check"))) = {#name, fn}
+
+/**
+ * Keeps the compiler from optimizing away a result the benchmark does not
+ * otherwise use
+ */
+#define BENCH_KEEP(value) __asm__ volatile("" : : "r"(value) : "memory")
+
+/**
+ * Runs all registered checks and benchmarks and writes one result line per
+ * check and benchmark to `fd`
+ *
+ * @return number of benchmarks run, -1 if a check failed
+ */
+int bench_run_all(int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+#include "bench.h"
+#include <cstdlib>
+
+/**
+ * C++ abstractions against their C equivalents: virtual calls against
+ * function pointers, new/delete against malloc()/free()
+ */
+
+namespace {
+
+struct counter {
+  virtual ~counter() = default;
+  virtual uint32_t step(uint32_t value) const = 0;
+};
+
+struct doubler final : counter {
+  uint32_t step(uint32_t value) const override { return value * 2 + 1; }
+};
+
+struct c_counter {
+  uint32_t (*step)(uint32_t value);
+};
+
+uint32_t c_doubler(uint32_t value) { return value * 2 + 1; }
+
+// Both are constant-initialized, the vtable pointer too, so neither adds an
+// .init_array entry
+const doubler staticDoubler;
+const c_counter staticCounter = {c_doubler};
+
+// Reached through volatile pointers so the calls stay indirect
+const counter *volatile virtualTarget = &staticDoubler;
+const c_counter *volatile pointerTarget = &staticCounter;
+
+void virtual_call(uintptr_t arg) {
+  const counter *target = virtualTarget;
+  uint32_t value = 0;
+  for (uintptr_t i = 0; i < arg; i++) {
+    value = target->step(value);
+  }
+  BENCH_KEEP(value);
+}
+
+void pointer_call(uintptr_t arg) {
+  const c_counter *target = pointerTarget;
+  uint32_t value = 0;
+  for (uintptr_t i = 0; i < arg; i++) {
+    value = target->step(value);
+  }
+  BENCH_KEEP(value);
+}
+
+void new_delete(uintptr_t arg) {
+  char *block = new char[arg];
+  BENCH_KEEP(block);
+  delete[] block;
+}
+
+void malloc_free(uintptr_t arg) {
+  char *block = static_cast<char *>(std::malloc(arg));
+  BENCH_KEEP(block);
+  std::free(block);
+}
+
+} // namespace
+
+BENCH(cxx_virtual_call, virtual_call, 64, 4, 32);
+BENCH(c_pointer_call, pointer_call, 64, 4, 32);
+BENCH(cxx_new_delete, new_delete, 64, 4, 32);
+BENCH(c_malloc_free, malloc_free, 64, 4, 32);
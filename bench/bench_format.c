@@ -0,0 +1,100 @@
+#include "bench.h"
+#include "format.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Heap-free formatter against newlib-nano's snprintf, and its output
+ * checked against C library results
+ */
+
+static char buffer[64];
+
+static void format_int(uintptr_t arg) {
+  BENCH_KEEP(format_snprintf(buffer, sizeof(buffer), "value %d: 0x%08x %s",
+                             (int)arg, (unsigned)arg, "done"));
+}
+
+static void newlib_int(uintptr_t arg) {
+  BENCH_KEEP(snprintf(buffer, sizeof(buffer), "value %d: 0x%08x %s", (int)arg,
+                      (unsigned)arg, "done"));
+}
+
+BENCH(format_snprintf, format_int, 123456, 4, 32);
+BENCH(newlib_snprintf, newlib_int, 123456, 4, 32);
+
+#define EXPECT(expected, ...)                                                  \
+  do {                                                                         \
+    char out[32];                                                              \
+    format_snprintf(out, sizeof(out), __VA_ARGS__);                            \
+    if (strcmp(out, expected) != 0) {                                          \
+      format_printf("%s: \"%s\", expected \"%s\"\n", #__VA_ARGS__, out,         \
+                    expected);                                                 \
+      failed++;                                                                \
+    }                                                                          \
+  } while (0)
+
+static int check_integers(void) {
+  int failed = 0;
+  EXPECT("-0042", "%05d", -42);
+  EXPECT("007", "%.3d", 7);
+  EXPECT("+3", "%+d", 3);
+  EXPECT("ab    |", "%-6s|", "ab");
+  EXPECT("", "%.0u", 0u);
+  EXPECT("0", "%#x", 0u);
+  EXPECT("010", "%#o", 8u);
+  EXPECT("0", "%#.0o", 0u);
+  // Above 32 bits: the 64-bit conversion path
+  EXPECT("5000000000", "%.0llu", 5000000000ULL);
+  EXPECT("0x100000000", "%#llx", 0x100000000ULL);
+  EXPECT("040000000000", "%#llo", 0x100000000ULL);
+  EXPECT("-9000000000", "%lld", -9000000000LL);
+  EXPECT("FFFFFFFFFFFFFFFF", "%llX", 0xFFFFFFFFFFFFFFFFULL);
+  EXPECT("        005000000000|", "%20.12llu|", 5000000000ULL);
+  EXPECT("", "%.0llx", 0ULL);
+  return failed;
+}
+
+BENCH_CHECK(format_integers, check_integers);
+
+#if defined(FORMAT_FLOAT)
+static int check_floats(void) {
+  int failed = 0;
+  EXPECT("3.141590", "%f", 3.14159f);
+  EXPECT("-001.500", "%08.3f", -1.5f);
+  EXPECT("+0.000000", "%+f", 0.0f);
+  // Exact binary ties round to even, everything else by its exact value
+  EXPECT("0", "%.0f", 0.5f);
+  EXPECT("2", "%.0f", 1.5f);
+  EXPECT("2", "%.0f", 2.5f);
+  EXPECT("0.2", "%.1f", 0.25f);
+  EXPECT("-2.67", "%.2f", -2.675f);
+  // Rounding carry into a new digit
+  EXPECT("9.999999", "%f", 9.9999995f);
+  EXPECT("10.00000", "%.5f", 9.9999995f);
+  EXPECT("9.999999e+00", "%e", 9.9999995f);
+  EXPECT("10", "%g", 9.9999995f);
+  EXPECT("100", "%.3g", 99.96f);
+  // 99.95f is 99.949997..., no carry
+  EXPECT("99.9", "%.3g", 99.95f);
+  EXPECT("9.99e+01", "%.2e", 99.95f);
+  EXPECT("1.234568e+04", "%e", 12345.678f);
+  EXPECT("1.230000E-04", "%E", 0.000123f);
+  EXPECT("2e+00", "%.0e", 2.5f);
+  EXPECT("0.0001", "%g", 0.0001f);
+  EXPECT("100000", "%g", 100000.0f);
+  EXPECT("1e+06", "%g", 1e6f);
+  EXPECT("1E-05", "%G", 1e-5f);
+  EXPECT("1.00000", "%#g", 1.0f);
+  EXPECT("inf", "%f", INFINITY);
+  EXPECT(" -inf", "%5.1f", -INFINITY);
+  EXPECT("INF", "%G", INFINITY);
+  EXPECT("nan", "%e", NAN);
+  // From 2^32 on, %f falls back to exponent form, see format.h
+  EXPECT("5.000000e+09", "%f", 5e9f);
+  return failed;
+}
+
+BENCH_CHECK(format_floats, check_floats);
+#endif
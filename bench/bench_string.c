@@ -0,0 +1,199 @@
+#include "bench.h"
+#include "format.h"
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * Throughput of string.S across sizes and alignments, against the byte
+ * loops of newlib-nano's size-optimized memcpy/memset. `arg` packs the
+ * size with the destination and source offsets from a word boundary.
+ *
+ * The checks run every length up to two LDM/STM blocks and beyond at all
+ * alignments, memmove overlapping in both directions, and fail on a wrong
+ * byte or one written outside the destination. The host build links its
+ * own C library in place of string.S, only the firmware build checks it.
+ */
+
+#define BUFFER_SIZE 4096
+
+#define STRING_ARG(size, dst, src) ((size) | (dst) << 16 | (src) << 24)
+#define STRING_SIZE(arg) ((arg) & 0xFFFF)
+#define STRING_DST(arg) (destination + ((arg) >> 16 & 0xFF))
+#define STRING_SRC(arg) (source + ((arg) >> 24))
+
+static uint8_t source[BUFFER_SIZE + 4] __attribute__((aligned(4)));
+static uint8_t destination[BUFFER_SIZE + 4] __attribute__((aligned(4)));
+
+static void copy(uintptr_t arg) {
+  BENCH_KEEP(memcpy(STRING_DST(arg), STRING_SRC(arg), STRING_SIZE(arg)));
+}
+
+static void move(uintptr_t arg) {
+  // Overlapping, destination above the source: copies downwards
+  BENCH_KEEP(memmove(source + 4, STRING_SRC(arg), STRING_SIZE(arg)));
+}
+
+static void set(uintptr_t arg) {
+  BENCH_KEEP(memset(STRING_DST(arg), 0x5A, STRING_SIZE(arg)));
+}
+
+// Kept as loops, GCC would otherwise replace them with memcpy/memset calls
+__attribute__((optimize("no-tree-loop-distribute-patterns")))
+static void bytes_copy(uintptr_t arg) {
+  uint8_t *dst = STRING_DST(arg);
+  const uint8_t *src = STRING_SRC(arg);
+  for (uint32_t i = 0; i < STRING_SIZE(arg); i++) {
+    dst[i] = src[i];
+  }
+  BENCH_KEEP(dst);
+}
+
+__attribute__((optimize("no-tree-loop-distribute-patterns")))
+static void bytes_set(uintptr_t arg) {
+  uint8_t *dst = STRING_DST(arg);
+  for (uint32_t i = 0; i < STRING_SIZE(arg); i++) {
+    dst[i] = 0x5A;
+  }
+  BENCH_KEEP(dst);
+}
+
+BENCH(memcpy_16, copy, STRING_ARG(16, 0, 0), 4, 32);
+BENCH(memcpy_256, copy, STRING_ARG(256, 0, 0), 4, 32);
+BENCH(memcpy_4096, copy, STRING_ARG(4096, 0, 0), 2, 16);
+// Source off by one: unaligned loads
+BENCH(memcpy_16_src1, copy, STRING_ARG(16, 0, 1), 4, 32);
+BENCH(memcpy_256_src1, copy, STRING_ARG(256, 0, 1), 4, 32);
+BENCH(memcpy_4096_src1, copy, STRING_ARG(4096, 0, 1), 2, 16);
+// Both off by one: aligned after three head bytes
+BENCH(memcpy_256_both1, copy, STRING_ARG(256, 1, 1), 4, 32);
+BENCH(memcpy_256_dst3, copy, STRING_ARG(256, 3, 0), 4, 32);
+BENCH(bytes_copy_16, bytes_copy, STRING_ARG(16, 0, 0), 4, 32);
+BENCH(bytes_copy_256, bytes_copy, STRING_ARG(256, 0, 0), 4, 32);
+BENCH(bytes_copy_4096, bytes_copy, STRING_ARG(4096, 0, 0), 2, 16);
+
+BENCH(memmove_256, move, STRING_ARG(256, 0, 0), 4, 32);
+BENCH(memmove_256_src1, move, STRING_ARG(256, 0, 1), 4, 32);
+
+BENCH(memset_16, set, STRING_ARG(16, 0, 0), 4, 32);
+BENCH(memset_256, set, STRING_ARG(256, 0, 0), 4, 32);
+BENCH(memset_4096, set, STRING_ARG(4096, 0, 0), 2, 16);
+BENCH(memset_256_dst1, set, STRING_ARG(256, 1, 0), 4, 32);
+BENCH(bytes_set_256, bytes_set, STRING_ARG(256, 0, 0), 4, 32);
+BENCH(bytes_set_4096, bytes_set, STRING_ARG(4096, 0, 0), 2, 16);
+
+// Lengths around the word, 32-byte block and chunk boundaries
+static const uint16_t checkLengths[] = {95,  96,  97,   127,  128,  129,
+                                        255, 256, 257,  1023, 1024, 1025};
+#define CHECK_SHORT 70
+#define CHECK_GUARD 8
+#define GUARD 0xEE
+
+#define CHECK_COUNT                                                           \
+  (CHECK_SHORT + 1 + sizeof(checkLengths) / sizeof(checkLengths[0]))
+#define CHECK_LENGTH(i)                                                        \
+  ((i) <= CHECK_SHORT ? (i) : checkLengths[(i) - CHECK_SHORT - 1])
+
+static uint8_t pattern(uint32_t i) { return (uint8_t)(i * 131 + 17); }
+
+// Kept as loops, the buffers must not be prepared by the functions checked
+__attribute__((optimize("no-tree-loop-distribute-patterns")))
+static void fill(uint8_t *buffer, uint32_t size, bool guard) {
+  for (uint32_t i = 0; i < size; i++) {
+    buffer[i] = guard ? GUARD : pattern(i);
+  }
+}
+
+/**
+ * Compares buffer[0, size) with the pattern moved from `src` to `dst` for
+ * `length` bytes, every other byte still GUARD or the pattern
+ */
+static int verify(const char *name, const uint8_t *buffer, uint32_t size,
+                  uint32_t dst, uint32_t src, uint32_t length, bool guard) {
+  for (uint32_t i = 0; i < size; i++) {
+    uint8_t expected = guard ? GUARD : pattern(i);
+    if (i >= dst && i < dst + length) {
+      expected = pattern(src + i - dst);
+    }
+    if (buffer[i] != expected) {
+      format_printf("%s dst+%lu src+%lu %lu bytes: [%lu] %02x, expected "
+                    "%02x\n",
+                    name, (unsigned long)dst, (unsigned long)src,
+                    (unsigned long)length, (unsigned long)i, buffer[i],
+                    expected);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int check_memcpy(void) {
+  int failed = 0;
+  fill(source, sizeof(source), false);
+  for (uint32_t i = 0; i < CHECK_COUNT; i++) {
+    uint32_t length = CHECK_LENGTH(i);
+    for (uint32_t dst = 0; dst < 4; dst++) {
+      for (uint32_t src = 0; src < 4; src++) {
+        uint32_t size = dst + length + CHECK_GUARD;
+        fill(destination, size, true);
+        void *result = memcpy(destination + dst, source + src, length);
+        failed += result != destination + dst ||
+                  verify("memcpy", destination, size, dst, src, length, true);
+      }
+    }
+  }
+  return failed;
+}
+
+static int check_memset(void) {
+  int failed = 0;
+  for (uint32_t i = 0; i < CHECK_COUNT; i++) {
+    uint32_t length = CHECK_LENGTH(i);
+    for (uint32_t dst = 0; dst < 4; dst++) {
+      uint32_t size = dst + length + CHECK_GUARD;
+      fill(destination, size, true);
+      // Only the low byte of the value counts
+      void *result = memset(destination + dst, 0x1A5, length);
+      failed += result != destination + dst;
+      for (uint32_t j = 0; j < size; j++) {
+        uint8_t expected = j >= dst && j < dst + length ? 0xA5 : GUARD;
+        if (destination[j] != expected) {
+          format_printf("memset dst+%lu %lu bytes: [%lu] %02x\n",
+                        (unsigned long)dst, (unsigned long)length,
+                        (unsigned long)j, destination[j]);
+          failed++;
+          break;
+        }
+      }
+    }
+  }
+  return failed;
+}
+
+static int check_memmove(void) {
+  // Distances between source and destination, both ways
+  static const uint8_t distances[] = {0, 1, 2, 3, 4, 5, 7, 8, 31, 32, 33, 64};
+  int failed = 0;
+  for (uint32_t i = 0; i < CHECK_COUNT; i++) {
+    uint32_t length = CHECK_LENGTH(i);
+    for (uint32_t base = 0; base < 4; base++) {
+      for (uint32_t d = 0; d < sizeof(distances); d++) {
+        for (uint32_t up = 0; up < 2; up++) {
+          uint32_t dst = base + (up ? distances[d] : 0);
+          uint32_t src = base + (up ? 0 : distances[d]);
+          uint32_t size = (dst > src ? dst : src) + length + CHECK_GUARD;
+          fill(destination, size, false);
+          void *result =
+              memmove(destination + dst, destination + src, length);
+          failed += result != destination + dst ||
+                    verify("memmove", destination, size, dst, src, length,
+                           false);
+        }
+      }
+    }
+  }
+  return failed;
+}
+
+BENCH_CHECK(memcpy, check_memcpy);
+BENCH_CHECK(memset, check_memset);
+BENCH_CHECK(memmove, check_memmove);
@@ -0,0 +1,65 @@
+#include "boot_bench.h"
+#include "format.h"
+#include "timebase.h"
+
+/**
+ * Synthetic boot image and boot time report, see boot_bench.h
+ */
+
+extern int _write(int file, char *ptr, int len);
+
+uint32_t bootBenchCycles;
+
+// Any non-zero initializer places the whole array into .data
+#if BOOT_BENCH_DATA > 0
+static uint8_t bootData[BOOT_BENCH_DATA] = {1};
+#endif
+
+#if BOOT_BENCH_BSS > 0
+static uint8_t bootBss[BOOT_BENCH_BSS];
+#endif
+
+static volatile uint32_t constructed;
+
+#if BOOT_BENCH_CTORS > 0
+static void construct(void) { constructed++; }
+
+// One .init_array entry per constructor, all pointing at the same function
+// (a GNU range initializer, hence __extension__)
+__extension__ static void (*const bootCtors[BOOT_BENCH_CTORS])(void)
+    __attribute__((used, section(".init_array"))) = {
+        [0 ... BOOT_BENCH_CTORS - 1] = construct};
+#endif
+
+int boot_bench_report(int fd) {
+  uint64_t cycles = bootBenchCycles + timebase_cycles();
+
+  // References keep --gc-sections from dropping the synthetic sections
+  uint32_t data = 0;
+  uint32_t bss = 0;
+#if BOOT_BENCH_DATA > 0
+  data = bootData[0];
+#endif
+#if BOOT_BENCH_BSS > 0
+  bss = bootBss[BOOT_BENCH_BSS - 1];
+#endif
+
+  int failed = BOOT_BENCH_MAX_CYCLES > 0 && cycles > BOOT_BENCH_MAX_CYCLES;
+  // The image is only valid if the copy and the constructors actually ran
+  if (data != (BOOT_BENCH_DATA > 0) || bss != 0 ||
+      constructed != BOOT_BENCH_CTORS) {
+    failed = 1;
+  }
+
+  char line[160];
+  int len = format_snprintf(
+      line, sizeof(line),
+      "{\"bench\":\"boot\",\"data\":%lu,\"bss\":%lu,\"ctors\":%lu,"
+      "\"cycles\":%lu,\"max\":%lu,\"hz\":%lu,\"ok\":%s}\n",
+      (unsigned long)BOOT_BENCH_DATA, (unsigned long)BOOT_BENCH_BSS,
+      (unsigned long)BOOT_BENCH_CTORS, (unsigned long)cycles,
+      (unsigned long)BOOT_BENCH_MAX_CYCLES, (unsigned long)SystemCoreClock,
+      failed ? "false" : "true");
+  _write(fd, line, len);
+  return failed;
+}
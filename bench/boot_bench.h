@@ -0,0 +1,81 @@
+#ifndef BOOT_BENCH_H
+#define BOOT_BENCH_H
+
+#include "device.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Cycles from reset to main().
+ *
+ * Reset_Handler starts counting before anything else runs. The counter
+ * (DWT CYCCNT, or a free-running SysTick where QEMU has no DWT) is read
+ * once more right before timebase_init() takes SysTick over, main() adds
+ * the cycles the time base has counted since.
+ *
+ * The image carries BOOT_BENCH_DATA bytes of .data, BOOT_BENCH_BSS bytes of
+ * .bss and BOOT_BENCH_CTORS constructors, so the copy loops and
+ * __libc_init_array() can be scaled up to a real application's.
+ */
+
+#if !defined(BOOT_BENCH_DATA)
+#define BOOT_BENCH_DATA 0
+#endif
+
+#if !defined(BOOT_BENCH_BSS)
+#define BOOT_BENCH_BSS 0
+#endif
+
+#if !defined(BOOT_BENCH_CTORS)
+#define BOOT_BENCH_CTORS 0
+#endif
+
+// 0 reports without a limit
+#if !defined(BOOT_BENCH_MAX_CYCLES)
+#define BOOT_BENCH_MAX_CYCLES 0
+#endif
+
+/**
+ * First thing in Reset_Handler, must not touch RAM
+ */
+static inline void boot_bench_start(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
+  SysTick->VAL = 0;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+
+/**
+ * Cycles since boot_bench_start()
+ */
+static inline uint32_t boot_bench_elapsed(void) {
+  if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) {
+    return DWT->CYCCNT;
+  }
+  // Counts down from the reload value, without wrapping for 2^24 cycles
+  return SysTick_LOAD_RELOAD_Msk - SysTick->VAL;
+}
+
+/**
+ * Cycles counted up to timebase_init(), set by Reset_Handler
+ */
+extern uint32_t bootBenchCycles;
+
+/**
+ * Writes the boot time as a JSON line to `fd`, first thing in main()
+ *
+ * @return 0, or 1 if the boot took more than BOOT_BENCH_MAX_CYCLES
+ */
+int boot_bench_report(int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,141 @@
+#include "bench.h"
+#include "format.h"
+#include "stm32f4xx.h"
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+/**
+ * Startup and runtime code that only the host build can run repeatedly,
+ * checked first and then timed
+ */
+
+extern void Reset_Handler(void);
+extern void host_run(void (*entry)(void));
+extern void *_sbrk(ptrdiff_t incr);
+extern int _gettimeofday(struct timeval *tv, void *tzvp);
+
+// Linker script symbols as Reset_Handler sees them, see CMakeLists.txt
+extern uint32_t hostFlashData[];
+extern uint32_t hostRam[];
+extern uint32_t _sidata, _sdata, host_edata, _sbss, _ebss;
+extern uint8_t _estack;
+extern uint32_t _Min_Stack_Size;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      format_printf("%s:%d: %s\n", __FILE__, __LINE__, #condition);           \
+      failed++;                                                                \
+    }                                                                          \
+  } while (0)
+
+// SystemInit, the .data copy and .bss fill over the sizes set in
+// CMakeLists.txt, clock gates and time base, until the idle WFI
+static void reset(uintptr_t arg) {
+  (void)arg;
+  host_run(Reset_Handler);
+}
+
+static void heap_round_trip(uintptr_t arg) {
+  BENCH_KEEP(_sbrk(arg));
+  BENCH_KEEP(_sbrk(-(ptrdiff_t)arg));
+}
+
+static void time_of_day(uintptr_t arg) {
+  (void)arg;
+  struct timeval tv;
+  _gettimeofday(&tv, NULL);
+  BENCH_KEEP(tv.tv_usec);
+}
+
+static int check_reset(void) {
+  int failed = 0;
+  CHECK(&_sidata == hostFlashData);
+  CHECK(&_sdata == hostRam);
+  CHECK(&host_edata == hostRam + HOST_DATA_SIZE / 4);
+  CHECK(&_sbss == &host_edata);
+  CHECK(&_ebss > &_sbss);
+  if (failed) {
+    return failed;
+  }
+
+  // Initializers to copy, and RAM as garbage as after power-up
+  for (uint32_t i = 0; i < HOST_DATA_SIZE / 4; i++) {
+    hostFlashData[i] = i * 0x9E3779B9U;
+  }
+  for (uint32_t *word = &_sdata; word < &_ebss; word++) {
+    *word = 0xA5A5A5A5U;
+  }
+  host_run(Reset_Handler);
+
+  for (uint32_t i = 0; i < HOST_DATA_SIZE / 4; i++) {
+    if (hostRam[i] != hostFlashData[i]) {
+      format_printf(".data[%lu] not copied\n", (unsigned long)i);
+      failed++;
+      break;
+    }
+  }
+  for (uint32_t *word = &_sbss; word < &_ebss; word++) {
+    if (*word != 0) {
+      format_printf(".bss+%lu not cleared\n",
+                    (unsigned long)(word - &_sbss) * 4);
+      failed++;
+      break;
+    }
+  }
+  return failed;
+}
+
+static int check_sbrk(void) {
+  int failed = 0;
+  uint8_t *start = _sbrk(0);
+  uint8_t *limit = &_estack - (uint32_t)&_Min_Stack_Size;
+  CHECK(start >= (uint8_t *)&_ebss && start <= limit);
+
+  // Up to the reserved stack, and not a byte into it
+  CHECK(_sbrk(limit - start) == start);
+  errno = 0;
+  CHECK(_sbrk(1) == (void *)-1);
+  CHECK(errno == ENOMEM);
+  CHECK(_sbrk(0) == limit);
+
+  CHECK(_sbrk(-(limit - start)) == limit);
+  CHECK(_sbrk(0) == start);
+  return failed;
+}
+
+static uint64_t time_of_day_us(void) {
+  struct timeval tv;
+  _gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000U + tv.tv_usec;
+}
+
+static int check_gettimeofday(void) {
+  // The time base counts DWT->CYCCNT, which only moves when told to here
+  int failed = 0;
+  uint32_t hz = SystemCoreClock;
+  uint64_t before = time_of_day_us();
+  DWT->CYCCNT += hz / 1000 * 3 / 2;
+  uint64_t after = time_of_day_us();
+  CHECK(after - before == 1500);
+
+  // Across CYCCNT wrapping around, in steps the time base can follow
+  before = after;
+  for (uint32_t i = 0; i < 8; i++) {
+    DWT->CYCCNT += 0x40000000U;
+    time_of_day_us();
+  }
+  after = time_of_day_us();
+  CHECK(after - before == (uint64_t)8 * 0x40000000U * 1000000U / hz);
+  return failed;
+}
+
+BENCH_CHECK(reset_handler, check_reset);
+BENCH_CHECK(sbrk, check_sbrk);
+BENCH_CHECK(gettimeofday, check_gettimeofday);
+
+BENCH(reset_handler, reset, 0, 2, 32);
+BENCH(sbrk_256, heap_round_trip, 256, 4, 64);
+BENCH(gettimeofday, time_of_day, 0, 4, 64);
@@ -0,0 +1,47 @@
+#ifndef CMSIS_HOST_H
+#define CMSIS_HOST_H
+
+#include <stdint.h>
+
+/**
+ * Replaces cmsis_gcc.h in host builds: its intrinsics are ARM assembly.
+ * Pre-included into every source, the guard keeps the original out.
+ */
+#define __CMSIS_GCC_H
+
+#define __ASM __asm
+#define __INLINE inline
+#define __STATIC_INLINE static inline
+#define __STATIC_FORCEINLINE __attribute__((always_inline)) static inline
+#define __NO_RETURN __attribute__((__noreturn__))
+#define __USED __attribute__((used))
+#define __WEAK __attribute__((weak))
+#define __PACKED __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x) __attribute__((aligned(x)))
+#define __RESTRICT __restrict
+#define __COMPILER_BARRIER() __ASM volatile("" ::: "memory")
+
+#define __NOP() __COMPILER_BARRIER()
+#define __DSB() __COMPILER_BARRIER()
+#define __DMB() __COMPILER_BARRIER()
+#define __ISB() __COMPILER_BARRIER()
+
+// Interrupts never arrive on the host, PRIMASK is just remembered
+extern uint32_t hostPrimask;
+
+static inline uint32_t __get_PRIMASK(void) { return hostPrimask; }
+static inline void __set_PRIMASK(uint32_t primask) { hostPrimask = primask; }
+static inline void __disable_irq(void) { hostPrimask = 1; }
+static inline void __enable_irq(void) { hostPrimask = 0; }
+
+/**
+ * Nothing would ever wake the core up: leaves the code under test, see
+ * host.c
+ */
+void host_wfi(void);
+#define __WFI() host_wfi()
+#define __WFE() host_wfi()
+
+#endif
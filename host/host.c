@@ -0,0 +1,73 @@
+#include "bench.h"
+#include "stm32f4xx.h"
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Host environment of the firmware sources: peripheral memory, the RAM
+ * behind the linker script symbols (see host.ld) and the runtime pieces
+ * newlib and the hardware would provide.
+ */
+
+uint32_t hostPrimask;
+
+RCC_TypeDef hostRcc;
+PWR_TypeDef hostPwr;
+FLASH_TypeDef hostFlash;
+SCB_Type hostScb;
+SysTick_Type hostSysTick;
+NVIC_Type hostNvic;
+DWT_Type hostDwt;
+CoreDebug_Type hostCoreDebug;
+
+// Initializers of .data as they would sit in flash, and the RAM holding
+// .data, .bss, heap and stack
+uint32_t hostFlashData[HOST_DATA_SIZE / 4];
+uint32_t hostRam[HOST_RAM_SIZE / 4];
+
+static jmp_buf *wfiExit;
+
+void host_wfi(void) {
+  if (wfiExit == NULL) {
+    fprintf(stderr, "WFI outside of host_run()\n");
+    abort();
+  }
+  longjmp(*wfiExit, 1);
+}
+
+void host_run(void (*entry)(void)) {
+  jmp_buf exit;
+  jmp_buf *outer = wfiExit;
+  wfiExit = &exit;
+  if (setjmp(exit) == 0) {
+    entry();
+  }
+  wfiExit = outer;
+}
+
+// Constructors of the firmware are the host's own here
+void __libc_init_array(void) {}
+
+int __io_putchar(int ch) { return putchar(ch); }
+int __io_getchar(void) { return getchar(); }
+
+uint32_t host_cycles(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+// Reset_Handler's call of main(), see CMakeLists.txt
+int host_app_main(void) { return 0; }
+
+extern void Reset_Handler(void);
+
+int main(void) {
+  // Benchmark cycles are host nanoseconds
+  SystemCoreClock = 1000000000U;
+  // Boot once so the firmware state is what main() would find
+  host_run(Reset_Handler);
+  return bench_run_all(1) > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
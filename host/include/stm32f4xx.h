@@ -0,0 +1,51 @@
+#ifndef HOST_STM32F4XX_H
+#define HOST_STM32F4XX_H
+
+/**
+ * Device header for host builds: the register blocks the firmware touches
+ * become plain memory in host.c instead of fixed peripheral addresses.
+ */
+
+#include_next "stm32f4xx.h"
+
+#undef RCC
+#undef PWR
+#undef FLASH
+#undef SCB
+#undef SysTick
+#undef NVIC
+#undef DWT
+#undef CoreDebug
+
+extern RCC_TypeDef hostRcc;
+extern PWR_TypeDef hostPwr;
+extern FLASH_TypeDef hostFlash;
+extern SCB_Type hostScb;
+extern SysTick_Type hostSysTick;
+extern NVIC_Type hostNvic;
+extern DWT_Type hostDwt;
+extern CoreDebug_Type hostCoreDebug;
+
+#define RCC (&hostRcc)
+#define PWR (&hostPwr)
+#define FLASH (&hostFlash)
+#define SCB (&hostScb)
+#define SysTick (&hostSysTick)
+#define NVIC (&hostNvic)
+#define DWT (&hostDwt)
+#define CoreDebug (&hostCoreDebug)
+
+// core_cm4.h's version was compiled against the real SysTick address
+static inline uint32_t host_SysTick_Config(uint32_t ticks) {
+  if (ticks - 1 > SysTick_LOAD_RELOAD_Msk) {
+    return 1;
+  }
+  SysTick->LOAD = ticks - 1;
+  SysTick->VAL = 0;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk |
+                  SysTick_CTRL_ENABLE_Msk;
+  return 0;
+}
+#define SysTick_Config host_SysTick_Config
+
+#endif
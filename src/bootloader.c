@@ -1,6 +1,17 @@
 #include "stdint.h"
-#include "system_stm32f4xx.h"
-#include "stm32f4xx.h"
+#include "stdlib.h"
+#include "string.h"
+#include "device.h"
+#include "timebase.h"
+#if defined(CORE_M4)
+#include "clock_gate.h"
+#endif
+#if defined(BOOT_BENCH)
+#include "boot_bench.h"
+#endif
+#if defined(SEMIHOSTING)
+#include "semihosting.h"
+#endif
 
 /**
  * Simple Bootloader implementation
@@ -17,6 +28,11 @@ extern uint32_t _edata;
 extern uint32_t _sbss;
 // end address for the .bss section. defined in linker script
 extern uint32_t _ebss;
+// load address, start and end of the code run from RAM. defined in linker
+// script
+extern uint32_t _siram_code;
+extern uint32_t _sram_code;
+extern uint32_t _eram_code;
 // Highest address of the user mode stack, end of RAM
 extern uint32_t _estack;
 
@@ -27,51 +43,95 @@ extern int main();
  * Application boot point
  */
 void Reset_Handler() {
+#if defined(BOOT_BENCH)
+  // Count the cycles to main()
+  boot_bench_start();
+#endif
+
+  // Copy the hot functions to SRAM first, at reset clocks with the caches
+  // off: SystemInit() and its boot clock switch may already call them
+  uint32_t *initCode = &_siram_code;
+  uint32_t *codePtr = &_sram_code;
+  while (codePtr < &_eram_code) {
+    *codePtr++ = *initCode++;
+  }
+
   // Call the clock system initialization function
   SystemInit();
 
-  // Copy the data segment initializers from flash to SRAM
-  uint32_t *initData = &_sidata;
-  uint32_t *dataPtr = &_sdata;
-  while (dataPtr < &_edata) {
-    *dataPtr++ = *initData++;
-  }
+#if defined(CORE_M7)
+  // Caches on before the copy loops below. Enabling invalidates them, so the
+  // RAM code copied above is fetched from SRAM.
+  SCB_EnableICache();
+  SCB_EnableDCache();
+#endif
 
-  // Zero fill the bss segment
-  uint32_t *bssPtr = &_sbss;
-  while (bssPtr < &_ebss) {
-    *bssPtr++ = 0;
-  }
+  // Copy the data segment initializers from flash to SRAM and zero fill the
+  // bss segment, with the burst copies of string.S
+  memcpy(&_sdata, &_sidata, (size_t)(&_edata - &_sdata) * 4);
+  memset(&_sbss, 0, (size_t)(&_ebss - &_sbss) * 4);
+
+#if defined(CORE_M4)
+  // Stop clocking unused peripherals in Sleep mode
+  clock_gate_init();
+#endif
+
+#if defined(BOOT_BENCH)
+  // The time base restarts the counters, keep what they counted so far
+  bootBenchCycles = boot_bench_elapsed();
+#endif
 
-  // Call static constructors
+  // Start the clock behind clock() and gettimeofday()
+  timebase_init();
+
+  // Call static constructors (.preinit_array, then .init_array by priority),
+  // after the time base so C++ objects can already use it and the delays
   __libc_init_array();
 
   // Call the application's entry point
+#if defined(SEMIHOSTING)
+  // Run destructors and report main's status to the debugger or QEMU
+  exit(main());
+#else
   main();
+#endif
 
-  // Infinite loop
-  while (1)
-    ;
+  // Nothing left to run, sleep between interrupts
+  while (1) {
+    __WFI();
+  }
 }
 
 /**
  * Catches all unhandled interrupts
  */
 void Default_Handler() {
-  while (1)
-    ;
+#if defined(SEMIHOSTING)
+  // Fail the run instead of hanging the debugger or QEMU
+  semihosting_exit(1);
+#endif
+  // Only interrupts of higher priority than this one can wake the core up
+  while (1) {
+    __WFI();
+  }
 }
 
 /**
  * Catches all class of fault
  */
 void HardFault_Handler() {
+#if defined(SEMIHOSTING)
+  semihosting_exit(1);
+#endif
   while (1)
     ;
 }
 
 // Interrupts list according to the STM32F4 spec
 __attribute__((weak)) void NMI_Handler(void) { Default_Handler(); }
+#if defined(CORE_M33)
+__attribute__((weak)) void SecureFault_Handler(void) { Default_Handler(); }
+#endif
 __attribute__((weak)) void MemManage_Handler(void) { Default_Handler(); }
 __attribute__((weak)) void BusFault_Handler(void) { Default_Handler(); }
 __attribute__((weak)) void UsageFault_Handler(void) { Default_Handler(); }
@@ -175,7 +235,11 @@ __attribute__((section(".isr_vector"))) void (*Vector_Table[])(void) = {
     MemManage_Handler,
     BusFault_Handler,
     UsageFault_Handler,
+#if defined(CORE_M33)
+    SecureFault_Handler,
+#else
     0,
+#endif
     0,
     0,
     0,
@@ -184,6 +248,7 @@ __attribute__((section(".isr_vector"))) void (*Vector_Table[])(void) = {
     0,
     PendSV_Handler,
     SysTick_Handler,
+#if defined(CORE_M4)
     WWDG_IRQHandler,
     PVD_IRQHandler,
     TAMP_STAMP_IRQHandler,
@@ -281,4 +346,5 @@ __attribute__((section(".isr_vector"))) void (*Vector_Table[])(void) = {
     SPDIF_RX_IRQHandler,
     FMPI2C1_EV_IRQHandler,
     FMPI2C1_ER_IRQHandler,
+#endif
 };
\ No newline at end of file
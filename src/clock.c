@@ -0,0 +1,490 @@
+#include "clock.h"
+#include "clock_config.h"
+#include "clock_gate.h"
+#include "stm32f4xx.h"
+#include "timebase.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Performance point switching, see clock.h
+ */
+
+// Ready flags come up within microseconds, this only guards against
+// an oscillator that never starts
+#define CLOCK_TIMEOUT_LOOPS 100000U
+
+struct perf_point {
+  bool usePll;
+  // VCO input is always 2 MHz, M depends on the PLL source
+  uint32_t n, p, q, r;
+  uint32_t vos;
+  bool overdrive;
+  // FLASH->ACR wait states for 2.7-3.6 V supply
+  uint32_t latency;
+  // RCC->CFGR HPRE/PPRE1/PPRE2 fields
+  uint32_t prescalers;
+};
+
+// Performance point running the PLL at `sys` Hz
+#define PLL_PERF_POINT(sys)                                                    \
+  {                                                                            \
+      .usePll = true,                                                          \
+      .n = CLOCK_PLL_N(sys),                                                   \
+      .p = CLOCK_PLL_P(sys),                                                   \
+      .q = CLOCK_PLL_Q(sys),                                                   \
+      .r = CLOCK_PLL_R(sys),                                                   \
+      .vos = CLOCK_VOS(sys),                                                   \
+      .overdrive = CLOCK_OVERDRIVE(sys),                                       \
+      .latency = CLOCK_FLASH_LATENCY(sys),                                     \
+      .prescalers = CLOCK_PRESCALERS(sys),                                     \
+  }
+
+CLOCK_STATIC_ASSERT_USB(HSI_VALUE, 84000000U);
+CLOCK_STATIC_ASSERT(HSI_VALUE, 180000000U);
+#if defined(CLOCK_SYSCLK_HZ)
+CLOCK_STATIC_ASSERT(HSI_VALUE, CLOCK_SYSCLK_HZ);
+#endif
+#if defined(CLOCK_HSE)
+// HSI stands in with the same N, P, Q and R when HSE fails
+CLOCK_STATIC_ASSERT_USB(HSE_VALUE, 84000000U);
+CLOCK_STATIC_ASSERT(HSE_VALUE, 180000000U);
+#if defined(CLOCK_SYSCLK_HZ)
+CLOCK_STATIC_ASSERT(HSE_VALUE, CLOCK_SYSCLK_HZ);
+#endif
+
+#if defined(CLOCK_HSE_BYPASS)
+#define HSE_BITS (RCC_CR_HSEON | RCC_CR_HSEBYP)
+#else
+#define HSE_BITS RCC_CR_HSEON
+#endif
+#endif
+
+static const struct perf_point perfPoints[CLOCK_PERF_COUNT] = {
+    [CLOCK_PERF_HSI_16MHZ] =
+        {
+            .usePll = false,
+            .vos = CLOCK_VOS(HSI_VALUE),
+            .latency = CLOCK_FLASH_LATENCY(HSI_VALUE),
+            .prescalers = CLOCK_PRESCALERS(HSI_VALUE),
+        },
+    [CLOCK_PERF_PLL_84MHZ] = PLL_PERF_POINT(84000000U),
+    [CLOCK_PERF_PLL_180MHZ] = PLL_PERF_POINT(180000000U),
+#if defined(CLOCK_SYSCLK_HZ)
+    [CLOCK_PERF_BOOT] = PLL_PERF_POINT(CLOCK_SYSCLK_HZ),
+#endif
+};
+
+#if defined(CLOCK_SYSCLK_HZ)
+#define APB1_DIV CLOCK_APB_DIV(CLOCK_SYSCLK_HZ, CLOCK_APB1_MAX_HZ)
+#define APB2_DIV CLOCK_APB_DIV(CLOCK_SYSCLK_HZ, CLOCK_APB2_MAX_HZ)
+
+// SystemInit() switches to the boot point before RAM is initialized, so
+// the snapshot of that state is computed at build time
+struct clock_tree clock_tree = {
+    .sysclk = CLOCK_SYSCLK_HZ,
+    .hclk = CLOCK_SYSCLK_HZ,
+    .pclk1 = CLOCK_SYSCLK_HZ / APB1_DIV,
+    .pclk2 = CLOCK_SYSCLK_HZ / APB2_DIV,
+    .apb1TimClk = CLOCK_SYSCLK_HZ / APB1_DIV * (APB1_DIV == 1 ? 1 : 2),
+    .apb2TimClk = CLOCK_SYSCLK_HZ / APB2_DIV * (APB2_DIV == 1 ? 1 : 2),
+    .pllq = CLOCK_VCO_HZ(CLOCK_SYSCLK_HZ) / CLOCK_PLL_Q(CLOCK_SYSCLK_HZ),
+    .pllr = CLOCK_VCO_HZ(CLOCK_SYSCLK_HZ) / CLOCK_PLL_R(CLOCK_SYSCLK_HZ),
+};
+
+static enum clock_perf_point currentPoint = CLOCK_PERF_BOOT;
+#else
+// Reset state: everything runs from HSI undivided
+struct clock_tree clock_tree = {
+    .sysclk = HSI_VALUE,
+    .hclk = HSI_VALUE,
+    .pclk1 = HSI_VALUE,
+    .pclk2 = HSI_VALUE,
+    .apb1TimClk = HSI_VALUE,
+    .apb2TimClk = HSI_VALUE,
+};
+
+static enum clock_perf_point currentPoint = CLOCK_PERF_HSI_16MHZ;
+#endif
+
+static clock_notify_fn notifiers[CLOCK_MAX_NOTIFIERS];
+
+#if defined(CLOCK_HSE)
+// Set once HSE failed to start or the clock security system tripped, the
+// latter from the NMI
+static volatile bool hseFailed;
+#endif
+
+static int wait_for(volatile uint32_t *reg, uint32_t mask, uint32_t value) {
+  for (uint32_t i = 0; i < CLOCK_TIMEOUT_LOOPS; i++) {
+    if ((*reg & mask) == value) {
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static void set_flash_latency(uint32_t latency) {
+  FLASH->ACR = FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN | latency;
+  // The new wait states apply once the register reads back
+  while ((FLASH->ACR & FLASH_ACR_LATENCY) != latency)
+    ;
+}
+
+static int switch_sysclk(uint32_t sw, uint32_t sws) {
+  RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | sw;
+  return wait_for(&RCC->CFGR, RCC_CFGR_SWS, sws);
+}
+
+/**
+ * Moves the system clock to HSI and stops the PLL, the only state from
+ * which voltage scale and over-drive may be changed
+ */
+static int enter_hsi(void) {
+  RCC->CR |= RCC_CR_HSION;
+  if (wait_for(&RCC->CR, RCC_CR_HSIRDY, RCC_CR_HSIRDY) != 0) {
+    return -1;
+  }
+  // Wait states stay at their current (higher) value, HSI is slower
+  if (switch_sysclk(RCC_CFGR_SW_HSI, RCC_CFGR_SWS_HSI) != 0) {
+    return -1;
+  }
+
+  PWR->CR &= ~(PWR_CR_ODSWEN | PWR_CR_ODEN);
+
+  RCC->CR &= ~RCC_CR_PLLON;
+  return wait_for(&RCC->CR, RCC_CR_PLLRDY, 0);
+}
+
+#if defined(CLOCK_HSE)
+/**
+ * Starts HSE with the clock security system watching it
+ */
+static int start_hse(void) {
+  if ((RCC->CR & HSE_BITS) != HSE_BITS) {
+    // The bypass bit may only change while HSE is off
+    RCC->CR = (RCC->CR & ~(RCC_CR_HSEON | RCC_CR_HSEBYP)) |
+              (HSE_BITS & ~RCC_CR_HSEON);
+    RCC->CR |= RCC_CR_HSEON;
+  }
+  if (wait_for(&RCC->CR, RCC_CR_HSERDY, RCC_CR_HSERDY) != 0) {
+    RCC->CR &= ~RCC_CR_HSEON;
+    return -1;
+  }
+  RCC->CR |= RCC_CR_CSSON;
+  return 0;
+}
+
+static void stop_hse(void) { RCC->CR &= ~(RCC_CR_CSSON | RCC_CR_HSEON); }
+#endif
+
+static int start_pll(const struct perf_point *point, bool hse) {
+  // The voltage scale is latched while the PLL is off
+  PWR->CR = (PWR->CR & ~PWR_CR_VOS) | point->vos;
+
+  uint32_t source = RCC_PLLCFGR_PLLSRC_HSI;
+  uint32_t m = CLOCK_PLL_M(HSI_VALUE);
+#if defined(CLOCK_HSE)
+  if (hse) {
+    if (start_hse() != 0) {
+      // Only the oscillator itself gives up HSE for good, not a PLL or
+      // regulator timeout
+      hseFailed = true;
+      return -1;
+    }
+    source = RCC_PLLCFGR_PLLSRC_HSE;
+    m = CLOCK_PLL_M(HSE_VALUE);
+  } else {
+    stop_hse();
+  }
+#else
+  (void)hse;
+#endif
+
+  RCC->PLLCFGR = source | (m << RCC_PLLCFGR_PLLM_Pos) |
+                 (point->n << RCC_PLLCFGR_PLLN_Pos) |
+                 ((point->p / 2 - 1) << RCC_PLLCFGR_PLLP_Pos) |
+                 (point->q << RCC_PLLCFGR_PLLQ_Pos) |
+                 (point->r << RCC_PLLCFGR_PLLR_Pos);
+  RCC->CR |= RCC_CR_PLLON;
+  if (wait_for(&RCC->CR, RCC_CR_PLLRDY, RCC_CR_PLLRDY) != 0) {
+    return -1;
+  }
+
+  if (point->overdrive) {
+    PWR->CR |= PWR_CR_ODEN;
+    if (wait_for(&PWR->CSR, PWR_CSR_ODRDY, PWR_CSR_ODRDY) != 0) {
+      return -1;
+    }
+    PWR->CR |= PWR_CR_ODSWEN;
+    if (wait_for(&PWR->CSR, PWR_CSR_ODSWRDY, PWR_CSR_ODSWRDY) != 0) {
+      return -1;
+    }
+  }
+
+  return wait_for(&PWR->CSR, PWR_CSR_VOSRDY, PWR_CSR_VOSRDY);
+}
+
+/**
+ * @param hse run the PLL from HSE instead of HSI, only in CLOCK_HSE builds
+ */
+static int apply(const struct perf_point *point, bool hse) {
+  if (enter_hsi() != 0) {
+    return -1;
+  }
+
+  if (!point->usePll) {
+#if defined(CLOCK_HSE)
+    stop_hse();
+#endif
+    PWR->CR = (PWR->CR & ~PWR_CR_VOS) | point->vos;
+    RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_HPRE | RCC_CFGR_PPRE1 |
+                               RCC_CFGR_PPRE2)) |
+                point->prescalers;
+    set_flash_latency(point->latency);
+    return 0;
+  }
+
+  if (start_pll(point, hse) != 0) {
+    return -1;
+  }
+
+  // Going up: wait states and bus dividers first, then the faster clock
+  uint32_t latency = FLASH->ACR & FLASH_ACR_LATENCY;
+  if (point->latency > latency) {
+    set_flash_latency(point->latency);
+  }
+  RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_HPRE | RCC_CFGR_PPRE1 |
+                             RCC_CFGR_PPRE2)) |
+              point->prescalers;
+  if (switch_sysclk(RCC_CFGR_SW_PLL, RCC_CFGR_SWS_PLL) != 0) {
+    return -1;
+  }
+  // Going down: wait states are relaxed only once the clock is slower
+  if (point->latency < latency) {
+    set_flash_latency(point->latency);
+  }
+  return 0;
+}
+
+// Extracts a register field by its CMSIS name
+#define FIELD(reg, name) (((reg) & name##_Msk) >> name##_Pos)
+
+/**
+ * Timer clocks run at twice the APB clock whenever the APB is divided, or
+ * up to four times with TIMPRE set
+ */
+static uint32_t timer_clock(uint32_t hclk, uint32_t pclk, uint32_t apbShift,
+                            uint32_t timpre) {
+  if (apbShift == 0) {
+    return pclk;
+  }
+  if (timpre && apbShift <= 2) {
+    return hclk;
+  }
+  return pclk << (timpre ? 2 : 1);
+}
+
+static uint32_t sai_clock(uint32_t source, uint32_t pllsaiq, uint32_t plli2sq,
+                          uint32_t pllr, uint32_t pllInput) {
+  switch (source) {
+  case 0:
+    return pllsaiq;
+  case 1:
+    return plli2sq;
+  case 2:
+    return pllr;
+  default:
+    // SAI1: external pin, SAI2: the PLL source oscillator
+    return pllInput;
+  }
+}
+
+void clock_tree_update(void) {
+  uint32_t cr = RCC->CR;
+  uint32_t cfgr = RCC->CFGR;
+  uint32_t pllcfgr = RCC->PLLCFGR;
+  uint32_t dckcfgr = RCC->DCKCFGR;
+  struct clock_tree tree = {0};
+
+  // All three PLLs share the main PLL's source oscillator
+  uint32_t pllInput = (pllcfgr & RCC_PLLCFGR_PLLSRC) ? HSE_VALUE : HSI_VALUE;
+
+  uint32_t pllm = FIELD(pllcfgr, RCC_PLLCFGR_PLLM);
+  uint32_t vco = 0;
+  uint32_t pllp = 0;
+  if (pllm != 0) {
+    vco = pllInput / pllm *
+          FIELD(pllcfgr, RCC_PLLCFGR_PLLN);
+    pllp = vco /
+           ((FIELD(pllcfgr, RCC_PLLCFGR_PLLP) + 1) * 2);
+  }
+  if (cr & RCC_CR_PLLRDY) {
+    tree.pllq = vco / FIELD(pllcfgr, RCC_PLLCFGR_PLLQ);
+    tree.pllr = vco / FIELD(pllcfgr, RCC_PLLCFGR_PLLR);
+  }
+
+  uint32_t pllsaiq = 0;
+  if (cr & RCC_CR_PLLSAIRDY) {
+    uint32_t reg = RCC->PLLSAICFGR;
+    uint32_t saiVco = pllInput / FIELD(reg, RCC_PLLSAICFGR_PLLSAIM) *
+                      FIELD(reg, RCC_PLLSAICFGR_PLLSAIN);
+    pllsaiq = saiVco / FIELD(reg, RCC_PLLSAICFGR_PLLSAIQ) /
+              (FIELD(dckcfgr, RCC_DCKCFGR_PLLSAIDIVQ) + 1);
+  }
+
+  uint32_t plli2sq = 0;
+  if (cr & RCC_CR_PLLI2SRDY) {
+    uint32_t reg = RCC->PLLI2SCFGR;
+    uint32_t i2sVco = pllInput / FIELD(reg, RCC_PLLI2SCFGR_PLLI2SM) *
+                      FIELD(reg, RCC_PLLI2SCFGR_PLLI2SN);
+    plli2sq = i2sVco / FIELD(reg, RCC_PLLI2SCFGR_PLLI2SQ) /
+              (FIELD(dckcfgr, RCC_DCKCFGR_PLLI2SDIVQ) + 1);
+  }
+
+  switch (cfgr & RCC_CFGR_SWS) {
+  case RCC_CFGR_SWS_HSE:
+    tree.sysclk = HSE_VALUE;
+    break;
+  case RCC_CFGR_SWS_PLL:
+    tree.sysclk = pllp;
+    break;
+  case RCC_CFGR_SWS_PLLR:
+    tree.sysclk = tree.pllr;
+    break;
+  default:
+    tree.sysclk = HSI_VALUE;
+    break;
+  }
+
+  uint32_t apb1Shift = APBPrescTable[FIELD(cfgr, RCC_CFGR_PPRE1)];
+  uint32_t apb2Shift = APBPrescTable[FIELD(cfgr, RCC_CFGR_PPRE2)];
+  uint32_t timpre = dckcfgr & RCC_DCKCFGR_TIMPRE;
+  tree.hclk = tree.sysclk >> AHBPrescTable[FIELD(cfgr, RCC_CFGR_HPRE)];
+  tree.pclk1 = tree.hclk >> apb1Shift;
+  tree.pclk2 = tree.hclk >> apb2Shift;
+  tree.apb1TimClk = timer_clock(tree.hclk, tree.pclk1, apb1Shift, timpre);
+  tree.apb2TimClk = timer_clock(tree.hclk, tree.pclk2, apb2Shift, timpre);
+
+  tree.sai1 = sai_clock(FIELD(dckcfgr, RCC_DCKCFGR_SAI1SRC),
+                        pllsaiq, plli2sq, tree.pllr, 0);
+  tree.sai2 = sai_clock(FIELD(dckcfgr, RCC_DCKCFGR_SAI2SRC),
+                        pllsaiq, plli2sq, tree.pllr, pllInput);
+
+  clock_tree = tree;
+  SystemCoreClock = tree.hclk;
+}
+
+int clock_register_notifier(clock_notify_fn notify) {
+  for (int i = 0; i < CLOCK_MAX_NOTIFIERS; i++) {
+    if (notifiers[i] == NULL) {
+      notifiers[i] = notify;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Switches with interrupts masked and refreshes everything that depends on
+ * the clock tree
+ */
+static int switch_locked(enum clock_perf_point point) {
+  // PWR keeps its settings with the clock gated again afterwards
+  clock_gate_acquire(CLOCK_GATE(APB1, PWR), false);
+#if defined(CLOCK_HSE)
+  bool hse = !hseFailed;
+  int result = apply(&perfPoints[point], hse);
+  if (result != 0 && hse && hseFailed) {
+    // HSE did not start, or the clock security NMI hit during the switch
+    result = apply(&perfPoints[point], false);
+  }
+#else
+  int result = apply(&perfPoints[point], false);
+#endif
+  clock_gate_release(CLOCK_GATE(APB1, PWR), false);
+  if (result == 0) {
+    currentPoint = point;
+  } else {
+    // Whatever failed, HSI is running and safe with the current settings
+    currentPoint = CLOCK_PERF_HSI_16MHZ;
+  }
+
+  clock_tree_update();
+  timebase_clock_update();
+  for (int i = 0; i < CLOCK_MAX_NOTIFIERS && notifiers[i] != NULL; i++) {
+    notifiers[i]();
+  }
+  return result;
+}
+
+int clock_set_perf_point(enum clock_perf_point point) {
+  if (point >= CLOCK_PERF_COUNT) {
+    return -1;
+  }
+
+  // No interrupt may observe the half-switched clock tree
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  int result = switch_locked(point);
+  __set_PRIMASK(primask);
+  return result;
+}
+
+enum clock_perf_point clock_get_perf_point(void) { return currentPoint; }
+
+bool clock_is_degraded(void) {
+#if defined(CLOCK_HSE)
+  // The PLL running from HSI also catches a fallback in clock_boot()
+  return hseFailed || ((RCC->CR & RCC_CR_PLLON) &&
+                       !(RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC));
+#else
+  return false;
+#endif
+}
+
+#if defined(CLOCK_HSE)
+extern void Default_Handler(void);
+
+/**
+ * The clock security system found HSE stopped. Hardware has already moved
+ * SYSCLK to HSI and stopped the PLL, which is a safe state to return to.
+ * PRIMASK does not mask the NMI, so the clock gate and time base state may
+ * be mid-update: the re-lock is left to PendSV at the lowest priority.
+ */
+void NMI_Handler(void) {
+  if (!(RCC->CIR & RCC_CIR_CSSF)) {
+    Default_Handler();
+  }
+  RCC->CIR |= RCC_CIR_CSSC;
+
+  hseFailed = true;
+  NVIC_SetPriority(PendSV_IRQn, (1U << __NVIC_PRIO_BITS) - 1);
+  SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+/**
+ * Completes the clock security failover: re-locks the PLL from HSI at the
+ * same performance point. Runs once no other handler and no masked section
+ * (clock_set_perf_point() included) is active.
+ */
+void PendSV_Handler(void) { clock_set_perf_point(currentPoint); }
+#endif
+
+#if defined(CLOCK_SYSCLK_HZ)
+int clock_boot(void) {
+  // Registers only: .data and .bss are not initialized yet, so neither are
+  // the clock gate counts
+  RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+  (void)RCC->APB1ENR;
+  int result = -1;
+#if defined(CLOCK_HSE)
+  result = apply(&perfPoints[CLOCK_PERF_BOOT], true);
+#endif
+  if (result != 0) {
+    result = apply(&perfPoints[CLOCK_PERF_BOOT], false);
+  }
+  RCC->APB1ENR &= ~RCC_APB1ENR_PWREN;
+  return result;
+}
+#endif
@@ -0,0 +1,110 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Runtime switching between predefined performance points.
+ *
+ * A switch orders the FLASH->ACR wait states, the PWR voltage scale and
+ * over-drive, and the bus prescalers so that every intermediate state is
+ * within the device limits, then notifies registered drivers.
+ *
+ * With CLOCK_HSE the PLL runs from the HSE crystal and the clock security
+ * system watches it. If HSE fails to start or stops, the PLL is re-locked
+ * from HSI at the same frequency and the clocks stay degraded to HSI
+ * accuracy until reset. The NMI of a stopped HSE leaves the re-lock to
+ * PendSV at the lowest priority, so these builds own PendSV_Handler.
+ */
+
+enum clock_perf_point {
+  CLOCK_PERF_HSI_16MHZ,
+  CLOCK_PERF_PLL_84MHZ,
+  CLOCK_PERF_PLL_180MHZ,
+#if defined(CLOCK_SYSCLK_HZ)
+  // SYSCLK requested at build time, PLL factors from clock_config.h
+  CLOCK_PERF_BOOT,
+#endif
+  CLOCK_PERF_COUNT,
+};
+
+/**
+ * Frequencies in Hz of the clock tree, 0 for outputs that are not running
+ */
+struct clock_tree {
+  uint32_t sysclk;
+  uint32_t hclk;
+  uint32_t pclk1;
+  uint32_t pclk2;
+  // timer kernel clocks on APB1 (TIM2..7, TIM12..14) and APB2 (TIM1,
+  // TIM8..11)
+  uint32_t apb1TimClk;
+  uint32_t apb2TimClk;
+  // main PLL Q (48 MHz domain) and R outputs
+  uint32_t pllq;
+  uint32_t pllr;
+  // SAI kernel clocks, 0 when fed from the external I2S_CKIN pin
+  uint32_t sai1;
+  uint32_t sai2;
+};
+
+/**
+ * Snapshot of the current clock tree, refreshed on every clock change.
+ * Read it instead of decoding RCC registers.
+ */
+extern struct clock_tree clock_tree;
+
+/**
+ * Decodes the RCC registers into clock_tree and SystemCoreClock, needed
+ * only after changing RCC outside of this module
+ */
+void clock_tree_update(void);
+
+#if !defined(CLOCK_MAX_NOTIFIERS)
+#define CLOCK_MAX_NOTIFIERS 8
+#endif
+
+/**
+ * Called after every switch, with interrupts still masked, so drivers can
+ * recompute baud rates and timer prescalers before any ISR runs. A clock
+ * security failover calls them from PendSV.
+ */
+typedef void (*clock_notify_fn)(void);
+
+/**
+ * @return 0 on success, -1 if the notifier table is full
+ */
+int clock_register_notifier(clock_notify_fn notify);
+
+/**
+ * @return 0 on success, -1 if an oscillator or regulator did not get ready
+ */
+int clock_set_perf_point(enum clock_perf_point point);
+
+enum clock_perf_point clock_get_perf_point(void);
+
+/**
+ * @return true if HSE failed and the PLL runs from HSI instead
+ */
+bool clock_is_degraded(void);
+
+#if defined(CLOCK_SYSCLK_HZ)
+/**
+ * Switches to CLOCK_PERF_BOOT from SystemInit(), before RAM is initialized.
+ * Falls back to HSI if HSE does not start.
+ *
+ * @return 0 on success, -1 if the PLL did not lock
+ */
+int clock_boot(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
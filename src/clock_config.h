@@ -0,0 +1,126 @@
+#ifndef CLOCK_CONFIG_H
+#define CLOCK_CONFIG_H
+
+#include "stm32f4xx.h"
+
+/**
+ * Compile-time PLL configuration for STM32F446.
+ *
+ * CLOCK_PLL_*(in, sys) pick PLL factors for a SYSCLK frequency `sys` from
+ * a PLL input oscillator `in`, and CLOCK_STATIC_ASSERT(in, sys) rejects
+ * anything outside the datasheet limits at build time:
+ *
+ *   VCO input  = in / M        1 .. 2 MHz (2 MHz is used, lowest jitter)
+ *   VCO output = VCO input * N 100 .. 432 MHz, 50 <= N <= 432
+ *   SYSCLK     = VCO / P       P in {2, 4, 6, 8}, at most 180 MHz
+ *   48 MHz     = VCO / Q       2 <= Q <= 15
+ *   PLLR       = VCO / R       2 <= R <= 7
+ *
+ * P is chosen so that VCO / Q lands exactly on 48 MHz for USB when such a
+ * P exists, otherwise the smallest P that keeps the VCO in range.
+ */
+
+#if !defined(HSE_VALUE)
+#define HSE_VALUE 25000000U
+#endif
+
+#if !defined(HSI_VALUE)
+#define HSI_VALUE 16000000U
+#endif
+
+#define CLOCK_VCO_IN_HZ 2000000U
+#define CLOCK_VCO_MIN_HZ 100000000U
+#define CLOCK_VCO_MAX_HZ 432000000U
+#define CLOCK_SYSCLK_MAX_HZ 180000000U
+#define CLOCK_USB_HZ 48000000U
+#define CLOCK_APB1_MAX_HZ 45000000U
+#define CLOCK_APB2_MAX_HZ 90000000U
+// Flash access time at 2.7-3.6 V supply
+#define CLOCK_FLASH_HZ_PER_WS 30000000U
+
+#define CLOCK_VCO_OK(sys, p)                                                   \
+  ((sys) * (p) >= CLOCK_VCO_MIN_HZ && (sys) * (p) <= CLOCK_VCO_MAX_HZ &&       \
+   (sys) * (p) % CLOCK_VCO_IN_HZ == 0)
+#define CLOCK_USB_OK(sys, p)                                                   \
+  (CLOCK_VCO_OK(sys, p) && (sys) * (p) % CLOCK_USB_HZ == 0 &&                  \
+   (sys) * (p) / CLOCK_USB_HZ <= 15)
+
+#define CLOCK_PLL_P(sys)                                                       \
+  (CLOCK_USB_OK(sys, 2U)   ? 2U                                                \
+   : CLOCK_USB_OK(sys, 4U) ? 4U                                                \
+   : CLOCK_USB_OK(sys, 6U) ? 6U                                                \
+   : CLOCK_USB_OK(sys, 8U) ? 8U                                                \
+   : CLOCK_VCO_OK(sys, 2U) ? 2U                                                \
+   : CLOCK_VCO_OK(sys, 4U) ? 4U                                                \
+   : CLOCK_VCO_OK(sys, 6U) ? 6U                                                \
+                           : 8U)
+#define CLOCK_VCO_HZ(sys) ((sys) * CLOCK_PLL_P(sys))
+
+#define CLOCK_PLL_M(in) ((in) / CLOCK_VCO_IN_HZ)
+#define CLOCK_PLL_N(sys) (CLOCK_VCO_HZ(sys) / CLOCK_VCO_IN_HZ)
+// Smallest divider that keeps the 48 MHz domain at or below 48 MHz
+#define CLOCK_PLL_Q(sys)                                                       \
+  ((CLOCK_VCO_HZ(sys) + CLOCK_USB_HZ - 1) / CLOCK_USB_HZ < 2                   \
+       ? 2U                                                                    \
+       : (CLOCK_VCO_HZ(sys) + CLOCK_USB_HZ - 1) / CLOCK_USB_HZ)
+// PLLR mirrors SYSCLK when the divider allows it
+#define CLOCK_PLL_R(sys) (CLOCK_PLL_P(sys) > 7U ? 7U : CLOCK_PLL_P(sys))
+
+#define CLOCK_FLASH_LATENCY(hclk) (((hclk) - 1) / CLOCK_FLASH_HZ_PER_WS)
+
+// Scale 3 up to 120 MHz, scale 2 up to 144 MHz, scale 1 above,
+// over-drive beyond 168 MHz
+#define CLOCK_VOS(hclk)                                                        \
+  ((hclk) <= 120000000U   ? (1U << PWR_CR_VOS_Pos)                             \
+   : (hclk) <= 144000000U ? (2U << PWR_CR_VOS_Pos)                             \
+                          : (3U << PWR_CR_VOS_Pos))
+#define CLOCK_OVERDRIVE(hclk) ((hclk) > 168000000U)
+
+#define CLOCK_APB_DIV(hclk, max)                                               \
+  ((hclk) <= (max)       ? 1U                                                  \
+   : (hclk) <= 2 * (max) ? 2U                                                  \
+   : (hclk) <= 4 * (max) ? 4U                                                  \
+   : (hclk) <= 8 * (max) ? 8U                                                  \
+                         : 16U)
+// RCC_CFGR_PPREx encoding of a divider: 1 -> 0b000, 2^k -> 0b1xx
+#define CLOCK_PPRE_BITS(div)                                                   \
+  ((div) == 1U ? 0U : (div) == 2U ? 4U : (div) == 4U ? 5U : (div) == 8U ? 6U : 7U)
+#define CLOCK_PRESCALERS(hclk)                                                 \
+  (RCC_CFGR_HPRE_DIV1 |                                                        \
+   (CLOCK_PPRE_BITS(CLOCK_APB_DIV(hclk, CLOCK_APB1_MAX_HZ))                    \
+    << RCC_CFGR_PPRE1_Pos) |                                                   \
+   (CLOCK_PPRE_BITS(CLOCK_APB_DIV(hclk, CLOCK_APB2_MAX_HZ))                    \
+    << RCC_CFGR_PPRE2_Pos))
+
+/**
+ * Rejects PLL settings outside the datasheet limits
+ */
+#define CLOCK_STATIC_ASSERT(in, sys)                                           \
+  _Static_assert((in) % CLOCK_VCO_IN_HZ == 0,                                  \
+                 "PLL input must be a multiple of 2 MHz");                     \
+  _Static_assert(CLOCK_PLL_M(in) >= 2 && CLOCK_PLL_M(in) <= 63,                \
+                 "PLLM out of range");                                         \
+  _Static_assert((sys) <= CLOCK_SYSCLK_MAX_HZ, "SYSCLK above 180 MHz");        \
+  _Static_assert(CLOCK_VCO_OK(sys, CLOCK_PLL_P(sys)),                          \
+                 "no PLLP puts the VCO into 100..432 MHz in 2 MHz steps");     \
+  _Static_assert(CLOCK_PLL_N(sys) >= 50 && CLOCK_PLL_N(sys) <= 432,            \
+                 "PLLN out of range");                                         \
+  _Static_assert(CLOCK_PLL_Q(sys) <= 15, "PLLQ out of range");                 \
+  _Static_assert(CLOCK_VCO_HZ(sys) / CLOCK_PLL_Q(sys) <= CLOCK_USB_HZ,         \
+                 "48 MHz domain overclocked");                                 \
+  _Static_assert(CLOCK_PLL_R(sys) >= 2 && CLOCK_PLL_R(sys) <= 7,               \
+                 "PLLR out of range");                                         \
+  _Static_assert(CLOCK_FLASH_LATENCY(sys) <= 5,                                \
+                 "flash latency beyond 5 wait states")
+
+/**
+ * Like CLOCK_STATIC_ASSERT, additionally requires an exact 48 MHz clock
+ * for USB OTG FS and SDIO
+ */
+#define CLOCK_STATIC_ASSERT_USB(in, sys)                                       \
+  CLOCK_STATIC_ASSERT(in, sys);                                                \
+  _Static_assert(CLOCK_VCO_HZ(sys) / CLOCK_PLL_Q(sys) == CLOCK_USB_HZ &&       \
+                     CLOCK_VCO_HZ(sys) % CLOCK_PLL_Q(sys) == 0,                \
+                 "SYSCLK does not allow an exact 48 MHz USB clock")
+
+#endif
@@ -0,0 +1,68 @@
+#include "clock_gate.h"
+#include <stdint.h>
+
+/**
+ * Peripheral clock gates, see clock_gate.h
+ */
+
+#define GATE_BUS(gate) ((gate) >> 5)
+#define GATE_BIT(gate) (1U << ((gate) & 31U))
+
+static volatile uint32_t *const enableRegs[CLOCK_GATE_BUS_COUNT] = {
+    &RCC->AHB1ENR, &RCC->AHB2ENR, &RCC->AHB3ENR, &RCC->APB1ENR, &RCC->APB2ENR,
+};
+
+static volatile uint32_t *const sleepRegs[CLOCK_GATE_BUS_COUNT] = {
+    &RCC->AHB1LPENR, &RCC->AHB2LPENR, &RCC->AHB3LPENR,
+    &RCC->APB1LPENR, &RCC->APB2LPENR,
+};
+
+// Memories have no run enable, the core and DMA need them in Sleep
+#define AHB1_MEMORIES                                                          \
+  (RCC_AHB1LPENR_FLITFLPEN | RCC_AHB1LPENR_SRAM1LPEN |                         \
+   RCC_AHB1LPENR_SRAM2LPEN | RCC_AHB1LPENR_BKPSRAMLPEN)
+
+static uint8_t runCount[CLOCK_GATE_BUS_COUNT][32];
+static uint8_t sleepCount[CLOCK_GATE_BUS_COUNT][32];
+
+void clock_gate_init(void) {
+  for (int bus = 0; bus < CLOCK_GATE_BUS_COUNT; bus++) {
+    uint32_t keep = *enableRegs[bus];
+    if (bus == CLOCK_GATE_AHB1) {
+      keep |= AHB1_MEMORIES;
+    }
+    *sleepRegs[bus] &= keep;
+  }
+}
+
+void clock_gate_acquire(unsigned gate, bool inSleep) {
+  unsigned bus = GATE_BUS(gate);
+  unsigned bit = gate & 31U;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (runCount[bus][bit]++ == 0) {
+    *enableRegs[bus] |= GATE_BIT(gate);
+    // The peripheral is accessible two clock cycles after enabling it
+    (void)*enableRegs[bus];
+  }
+  if (inSleep && sleepCount[bus][bit]++ == 0) {
+    *sleepRegs[bus] |= GATE_BIT(gate);
+  }
+  __set_PRIMASK(primask);
+}
+
+void clock_gate_release(unsigned gate, bool inSleep) {
+  unsigned bus = GATE_BUS(gate);
+  unsigned bit = gate & 31U;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (inSleep && sleepCount[bus][bit] != 0 && --sleepCount[bus][bit] == 0) {
+    *sleepRegs[bus] &= ~GATE_BIT(gate);
+  }
+  if (runCount[bus][bit] != 0 && --runCount[bus][bit] == 0) {
+    *enableRegs[bus] &= ~GATE_BIT(gate);
+  }
+  __set_PRIMASK(primask);
+}
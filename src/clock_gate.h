@@ -0,0 +1,54 @@
+#ifndef CLOCK_GATE_H
+#define CLOCK_GATE_H
+
+#include "stm32f4xx.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Reference-counted peripheral clock gates.
+ *
+ * Every enable bit of RCC AHB1/2/3 and APB1/2 is a gate. The first acquire
+ * turns the peripheral clock on, the last release turns it off again.
+ * Acquiring with `inSleep` also keeps the clock running in Sleep mode
+ * (the *LPENR bit), for peripherals that have to wake the core or keep
+ * working while it idles.
+ */
+
+enum clock_gate_bus {
+  CLOCK_GATE_AHB1,
+  CLOCK_GATE_AHB2,
+  CLOCK_GATE_AHB3,
+  CLOCK_GATE_APB1,
+  CLOCK_GATE_APB2,
+  CLOCK_GATE_BUS_COUNT,
+};
+
+/**
+ * Gate of a peripheral by its CMSIS names, e.g. CLOCK_GATE(AHB1, GPIOA)
+ * for RCC_AHB1ENR_GPIOAEN or CLOCK_GATE(APB1, PWR) for RCC_APB1ENR_PWREN
+ */
+#define CLOCK_GATE(bus, name)                                                  \
+  ((CLOCK_GATE_##bus << 5) | RCC_##bus##ENR_##name##EN_Pos)
+
+/**
+ * Gates Sleep mode clocks of every peripheral that is not enabled right
+ * now. The low-power enable bits all reset to on.
+ */
+void clock_gate_init(void);
+
+void clock_gate_acquire(unsigned gate, bool inSleep);
+
+/**
+ * Must be called with the same `inSleep` as the matching acquire
+ */
+void clock_gate_release(unsigned gate, bool inSleep);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,216 @@
+#include "crc.h"
+#include "clock_gate.h"
+#include "stm32f4xx.h"
+
+/**
+ * CRC unit fed by DMA or word writes, see crc.h
+ */
+
+// Memory-to-memory transfers need DMA2, any stream does
+#define CRC_DMA DMA2
+#define CRC_DMA_STREAM DMA2_Stream0
+#define CRC_DMA_IRQ DMA2_Stream0_IRQn
+#define CRC_DMA_FLAGS                                                          \
+  (DMA_LIFCR_CTCIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTEIF0 |                    \
+   DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0)
+#define CRC_DMA_ERRORS (DMA_LISR_TEIF0 | DMA_LISR_DMEIF0 | DMA_LISR_FEIF0)
+
+// Words per DMA transfer (NDTR is 16 bits), kept a multiple of the burst
+#define CRC_DMA_CHUNK 65532U
+// With bursts NDTR has to be a multiple of the burst length
+#define CRC_DMA_BURST 4U
+_Static_assert(CRC_DMA_MIN_WORDS >= CRC_DMA_BURST,
+               "DMA blocks need at least one whole burst");
+
+// Source (peripheral port) increments in 4-word bursts through the FIFO,
+// the destination stays on CRC->DR. Word-sized on both sides.
+#define CRC_DMA_CR                                                             \
+  (DMA_SxCR_DIR_1 | DMA_SxCR_PINC | DMA_SxCR_PSIZE_1 | DMA_SxCR_MSIZE_1 |      \
+   DMA_SxCR_PBURST_0 | DMA_SxCR_PL_0 | DMA_SxCR_TCIE | DMA_SxCR_TEIE)
+
+static const uint32_t table[256] = {
+    0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9, 0x130476DC, 0x17C56B6B,
+    0x1A864DB2, 0x1E475005, 0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
+    0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD, 0x4C11DB70, 0x48D0C6C7,
+    0x4593E01E, 0x4152FDA9, 0x5F15ADAC, 0x5BD4B01B, 0x569796C2, 0x52568B75,
+    0x6A1936C8, 0x6ED82B7F, 0x639B0DA6, 0x675A1011, 0x791D4014, 0x7DDC5DA3,
+    0x709F7B7A, 0x745E66CD, 0x9823B6E0, 0x9CE2AB57, 0x91A18D8E, 0x95609039,
+    0x8B27C03C, 0x8FE6DD8B, 0x82A5FB52, 0x8664E6E5, 0xBE2B5B58, 0xBAEA46EF,
+    0xB7A96036, 0xB3687D81, 0xAD2F2D84, 0xA9EE3033, 0xA4AD16EA, 0xA06C0B5D,
+    0xD4326D90, 0xD0F37027, 0xDDB056FE, 0xD9714B49, 0xC7361B4C, 0xC3F706FB,
+    0xCEB42022, 0xCA753D95, 0xF23A8028, 0xF6FB9D9F, 0xFBB8BB46, 0xFF79A6F1,
+    0xE13EF6F4, 0xE5FFEB43, 0xE8BCCD9A, 0xEC7DD02D, 0x34867077, 0x30476DC0,
+    0x3D044B19, 0x39C556AE, 0x278206AB, 0x23431B1C, 0x2E003DC5, 0x2AC12072,
+    0x128E9DCF, 0x164F8078, 0x1B0CA6A1, 0x1FCDBB16, 0x018AEB13, 0x054BF6A4,
+    0x0808D07D, 0x0CC9CDCA, 0x7897AB07, 0x7C56B6B0, 0x71159069, 0x75D48DDE,
+    0x6B93DDDB, 0x6F52C06C, 0x6211E6B5, 0x66D0FB02, 0x5E9F46BF, 0x5A5E5B08,
+    0x571D7DD1, 0x53DC6066, 0x4D9B3063, 0x495A2DD4, 0x44190B0D, 0x40D816BA,
+    0xACA5C697, 0xA864DB20, 0xA527FDF9, 0xA1E6E04E, 0xBFA1B04B, 0xBB60ADFC,
+    0xB6238B25, 0xB2E29692, 0x8AAD2B2F, 0x8E6C3698, 0x832F1041, 0x87EE0DF6,
+    0x99A95DF3, 0x9D684044, 0x902B669D, 0x94EA7B2A, 0xE0B41DE7, 0xE4750050,
+    0xE9362689, 0xEDF73B3E, 0xF3B06B3B, 0xF771768C, 0xFA325055, 0xFEF34DE2,
+    0xC6BCF05F, 0xC27DEDE8, 0xCF3ECB31, 0xCBFFD686, 0xD5B88683, 0xD1799B34,
+    0xDC3ABDED, 0xD8FBA05A, 0x690CE0EE, 0x6DCDFD59, 0x608EDB80, 0x644FC637,
+    0x7A089632, 0x7EC98B85, 0x738AAD5C, 0x774BB0EB, 0x4F040D56, 0x4BC510E1,
+    0x46863638, 0x42472B8F, 0x5C007B8A, 0x58C1663D, 0x558240E4, 0x51435D53,
+    0x251D3B9E, 0x21DC2629, 0x2C9F00F0, 0x285E1D47, 0x36194D42, 0x32D850F5,
+    0x3F9B762C, 0x3B5A6B9B, 0x0315D626, 0x07D4CB91, 0x0A97ED48, 0x0E56F0FF,
+    0x1011A0FA, 0x14D0BD4D, 0x19939B94, 0x1D528623, 0xF12F560E, 0xF5EE4BB9,
+    0xF8AD6D60, 0xFC6C70D7, 0xE22B20D2, 0xE6EA3D65, 0xEBA91BBC, 0xEF68060B,
+    0xD727BBB6, 0xD3E6A601, 0xDEA580D8, 0xDA649D6F, 0xC423CD6A, 0xC0E2D0DD,
+    0xCDA1F604, 0xC960EBB3, 0xBD3E8D7E, 0xB9FF90C9, 0xB4BCB610, 0xB07DABA7,
+    0xAE3AFBA2, 0xAAFBE615, 0xA7B8C0CC, 0xA379DD7B, 0x9B3660C6, 0x9FF77D71,
+    0x92B45BA8, 0x9675461F, 0x8832161A, 0x8CF30BAD, 0x81B02D74, 0x857130C3,
+    0x5D8A9099, 0x594B8D2E, 0x5408ABF7, 0x50C9B640, 0x4E8EE645, 0x4A4FFBF2,
+    0x470CDD2B, 0x43CDC09C, 0x7B827D21, 0x7F436096, 0x7200464F, 0x76C15BF8,
+    0x68860BFD, 0x6C47164A, 0x61043093, 0x65C52D24, 0x119B4BE9, 0x155A565E,
+    0x18197087, 0x1CD86D30, 0x029F3D35, 0x065E2082, 0x0B1D065B, 0x0FDC1BEC,
+    0x3793A651, 0x3352BBE6, 0x3E119D3F, 0x3AD08088, 0x2497D08D, 0x2056CD3A,
+    0x2D15EBE3, 0x29D4F654, 0xC5A92679, 0xC1683BCE, 0xCC2B1D17, 0xC8EA00A0,
+    0xD6AD50A5, 0xD26C4D12, 0xDF2F6BCB, 0xDBEE767C, 0xE3A1CBC1, 0xE760D676,
+    0xEA23F0AF, 0xEEE2ED18, 0xF0A5BD1D, 0xF464A0AA, 0xF9278673, 0xFDE69BC4,
+    0x89B8FD09, 0x8D79E0BE, 0x803AC667, 0x84FBDBD0, 0x9ABC8BD5, 0x9E7D9662,
+    0x933EB0BB, 0x97FFAD0C, 0xAFB010B1, 0xAB710D06, 0xA6322BDF, 0xA2F33668,
+    0xBCB4666D, 0xB8757BDA, 0xB5365D03, 0xB1F740B4,
+};
+
+// Rest of the block still to hand to the DMA, then the words short of a
+// whole burst, written by the CPU
+static const uint32_t *nextWords;
+static size_t remaining;
+static size_t tail;
+static volatile bool busy;
+static volatile bool failed;
+
+static void feed_words(const uint32_t *words, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    CRC->DR = words[i];
+  }
+}
+
+static void release(void) {
+  clock_gate_release(CLOCK_GATE(AHB1, DMA2), true);
+  busy = false;
+}
+
+/**
+ * Hands the next chunk to the stream, interrupts must be masked
+ */
+static void start_chunk(void) {
+  size_t count = remaining > CRC_DMA_CHUNK ? CRC_DMA_CHUNK : remaining;
+  CRC_DMA_STREAM->PAR = (uint32_t)nextWords;
+  CRC_DMA_STREAM->M0AR = (uint32_t)&CRC->DR;
+  CRC_DMA_STREAM->NDTR = count;
+  nextWords += count;
+  remaining -= count;
+  CRC_DMA_STREAM->CR = CRC_DMA_CR | DMA_SxCR_EN;
+}
+
+/**
+ * Completes a chunk once the stream is done, interrupts must be masked
+ */
+static void service(void) {
+  uint32_t flags = CRC_DMA->LISR;
+  if (!(flags & (DMA_LISR_TCIF0 | CRC_DMA_ERRORS))) {
+    return;
+  }
+  CRC_DMA->LIFCR = CRC_DMA_FLAGS;
+
+  if (flags & CRC_DMA_ERRORS) {
+    failed = true;
+    release();
+  } else if (remaining) {
+    start_chunk();
+  } else {
+    feed_words(nextWords, tail);
+    release();
+  }
+}
+
+static void start(const uint32_t *words, size_t count, bool reset) {
+  // Kept on in Sleep mode so the caller may idle while the DMA runs
+  clock_gate_acquire(CLOCK_GATE(AHB1, CRC), true);
+  if (reset) {
+    CRC->CR = CRC_CR_RESET;
+  }
+  failed = false;
+  if (count < CRC_DMA_MIN_WORDS) {
+    feed_words(words, count);
+    return;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  clock_gate_acquire(CLOCK_GATE(AHB1, DMA2), true);
+  CRC_DMA->LIFCR = CRC_DMA_FLAGS;
+  CRC_DMA_STREAM->CR = 0;
+  while (CRC_DMA_STREAM->CR & DMA_SxCR_EN) {
+  }
+  // Memory-to-memory requires the FIFO
+  CRC_DMA_STREAM->FCR = DMA_SxFCR_DMDIS | DMA_SxFCR_FTH;
+  NVIC_EnableIRQ(CRC_DMA_IRQ);
+
+  nextWords = words;
+  tail = count % CRC_DMA_BURST;
+  remaining = count - tail;
+  busy = true;
+  start_chunk();
+  if (!(CRC_DMA_STREAM->CR & DMA_SxCR_EN) &&
+      !(CRC_DMA->LISR & (DMA_LISR_TCIF0 | CRC_DMA_ERRORS))) {
+    // Neither running nor done: no DMA behind the registers (QEMU)
+    failed = true;
+    release();
+  }
+  __set_PRIMASK(primask);
+}
+
+void crc_start(const uint32_t *words, size_t count) {
+  start(words, count, true);
+}
+
+void crc_continue(const uint32_t *words, size_t count) {
+  // The unit keeps the running value in CRC->DR
+  start(words, count, false);
+}
+
+bool crc_busy(void) { return busy; }
+
+int crc_finish(uint32_t *crc) {
+  while (busy) {
+    // Also completes the transfer when the caller masks interrupts
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    service();
+    __set_PRIMASK(primask);
+  }
+  *crc = CRC->DR;
+  clock_gate_release(CLOCK_GATE(AHB1, CRC), true);
+  return failed ? -1 : 0;
+}
+
+uint32_t crc_compute(const uint32_t *words, size_t count) {
+  uint32_t crc;
+  crc_start(words, count);
+  if (crc_finish(&crc) != 0) {
+    clock_gate_acquire(CLOCK_GATE(AHB1, CRC), false);
+    CRC->CR = CRC_CR_RESET;
+    feed_words(words, count);
+    crc = CRC->DR;
+    clock_gate_release(CLOCK_GATE(AHB1, CRC), false);
+  }
+  return crc;
+}
+
+uint32_t crc_software(uint32_t crc, const uint32_t *words, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    uint32_t word = words[i];
+    // Most significant byte first, like the unit
+    crc = (crc << 8) ^ table[(crc >> 24) ^ (word >> 24)];
+    crc = (crc << 8) ^ table[(crc >> 24) ^ ((word >> 16) & 0xFF)];
+    crc = (crc << 8) ^ table[(crc >> 24) ^ ((word >> 8) & 0xFF)];
+    crc = (crc << 8) ^ table[(crc >> 24) ^ (word & 0xFF)];
+  }
+  return crc;
+}
+
+void DMA2_Stream0_IRQHandler(void) { service(); }
@@ -0,0 +1,72 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * CRC-32 over 32-bit words with the CRC calculation unit.
+ *
+ * The unit computes the STM32 CRC: polynomial 0x04C11DB7, initial value
+ * 0xFFFFFFFF, each word fed most significant bit first, no final XOR
+ * (CRC-32/MPEG-2 over the words as they are in memory). crc_software()
+ * computes the same value with a table, e.g. on the build machine.
+ *
+ * Blocks of at least CRC_DMA_MIN_WORDS words are fed by DMA2 Stream 0 in
+ * memory-to-memory mode, the CPU is free until crc_finish() except for the
+ * last count % 4 words, which it writes after the transfer. Shorter blocks
+ * are written word by word, where setting up the DMA would cost more than
+ * it saves. Every crc_start() or crc_continue() ends with crc_finish().
+ * There is one unit: a computation has to finish before the next one
+ * starts, and must not be interleaved with one from an interrupt.
+ */
+
+#if !defined(CRC_DMA_MIN_WORDS)
+#define CRC_DMA_MIN_WORDS 64
+#endif
+
+#define CRC_INITIAL 0xFFFFFFFFU
+
+/**
+ * Starts a new CRC over `count` words, returns before the DMA is done
+ */
+void crc_start(const uint32_t *words, size_t count);
+
+/**
+ * Like crc_start(), continuing the CRC of the previous computation
+ */
+void crc_continue(const uint32_t *words, size_t count);
+
+/**
+ * @return true while the DMA is still feeding the unit
+ */
+bool crc_busy(void);
+
+/**
+ * Waits for the DMA and stores the CRC in `crc`
+ *
+ * @return 0, or -1 if the DMA failed (e.g. on an address it cannot read)
+ */
+int crc_finish(uint32_t *crc);
+
+/**
+ * Blocking CRC over `count` words, falls back to word writes if the DMA
+ * fails
+ */
+uint32_t crc_compute(const uint32_t *words, size_t count);
+
+/**
+ * Table-driven software version, start with `crc` = CRC_INITIAL
+ */
+uint32_t crc_software(uint32_t crc, const uint32_t *words, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
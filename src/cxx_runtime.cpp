@@ -0,0 +1,71 @@
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Minimal C++ runtime for firmware built with -fno-exceptions -fno-rtti
+ * -fno-threadsafe-statics.
+ *
+ * Dynamic allocation maps onto newlib's malloc()/free() and so onto the heap
+ * managed by _sbrk(). Without exceptions there is no std::bad_alloc, running
+ * out of memory aborts instead. Linking this file keeps libstdc++'s versions,
+ * and the unwinder and RTTI they pull in, out of the image.
+ */
+
+static void *allocate(std::size_t size) {
+  // malloc(0) may return NULL, new must return a unique pointer
+  void *ptr = std::malloc(size ? size : 1);
+  if (!ptr) {
+    std::abort();
+  }
+  return ptr;
+}
+
+void *operator new(std::size_t size) { return allocate(size); }
+
+void *operator new[](std::size_t size) { return allocate(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+extern "C" {
+
+/**
+ * Called for a pure virtual function through a partially constructed or
+ * destroyed object
+ */
+void __cxa_pure_virtual(void) { std::abort(); }
+
+/**
+ * Same for a deleted virtual function
+ */
+void __cxa_deleted_virtual(void) { std::abort(); }
+
+#if !defined(SEMIHOSTING)
+/**
+ * Registers the destructor of a static object. main() never returns on the
+ * board, so the destructors would never run: dropping them saves newlib's
+ * atexit table in RAM. With semihosting exit() still runs them.
+ */
+int __cxa_atexit(void (*destructor)(void *), void *object, void *dso) {
+  (void)destructor;
+  (void)object;
+  (void)dso;
+  return 0;
+}
+#endif
+
+}
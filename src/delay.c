@@ -0,0 +1,72 @@
+#include "delay.h"
+#include "timebase.h"
+
+/**
+ * DWT-based delays, see delay.h
+ */
+
+// Longest single wait handed to delay_cycles()
+#define DELAY_CHUNK_CYCLES (1U << 30)
+
+// Conversion factors for cachedHz: cycles per ns in 0.32 fixed point and
+// cycles per us in 16.16 fixed point, both rounded up
+static uint32_t cachedHz;
+static uint32_t cyclesPerNs;
+static uint32_t cyclesPerUs;
+
+static void update_factors(void) {
+  uint32_t hz = SystemCoreClock;
+  if (hz == cachedHz) {
+    return;
+  }
+  cyclesPerNs = (uint32_t)((((uint64_t)hz << 32) + 999999999U) / 1000000000U);
+  cyclesPerUs = (uint32_t)((((uint64_t)hz << 16) + 999999U) / 1000000U);
+  cachedHz = hz;
+}
+
+void delay_cycles_slow(uint32_t cycles) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) {
+    delay_cycles(cycles);
+    return;
+  }
+
+  uint64_t end = timebase_cycles() + cycles;
+  while (timebase_cycles() < end)
+    ;
+}
+
+static void wait_cycles(uint64_t cycles) {
+  while (cycles > DELAY_CHUNK_CYCLES) {
+    delay_cycles(DELAY_CHUNK_CYCLES);
+    cycles -= DELAY_CHUNK_CYCLES;
+  }
+  delay_cycles((uint32_t)cycles);
+}
+
+void delay_ns(uint32_t ns) {
+  update_factors();
+  wait_cycles(((uint64_t)ns * cyclesPerNs + UINT32_MAX) >> 32);
+}
+
+void delay_us(uint32_t us) {
+  update_factors();
+  wait_cycles(((uint64_t)us * cyclesPerUs + UINT16_MAX) >> 16);
+}
+
+void delay_ms(uint32_t ms) {
+  wait_cycles((uint64_t)ms * ((SystemCoreClock + 999U) / 1000U));
+}
+
+void delay_timeout_start_us(struct delay_timeout *timeout, uint32_t us) {
+  timeout->deadlineNs = timebase_ns() + (uint64_t)us * 1000U;
+}
+
+void delay_timeout_start_ms(struct delay_timeout *timeout, uint32_t ms) {
+  timeout->deadlineNs = timebase_ns() + (uint64_t)ms * 1000000U;
+}
+
+bool delay_timeout_expired(const struct delay_timeout *timeout) {
+  return timebase_ns() >= timeout->deadlineNs;
+}
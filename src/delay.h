@@ -0,0 +1,59 @@
+#ifndef DELAY_H
+#define DELAY_H
+
+#include "device.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Busy-wait delays and timeouts.
+ *
+ * Delays count DWT cycles at the current SystemCoreClock, so they last as
+ * long at -O0 as at -Os and follow clock changes. Every delay is a lower
+ * bound: call overhead and interrupts only make it longer. They work once
+ * RAM is initialized, the cycle counter is started on first use.
+ */
+
+/**
+ * Starts the cycle counter, or waits on the time base where there is none
+ */
+void delay_cycles_slow(uint32_t cycles);
+
+/**
+ * Waits at least `cycles` core clock cycles, up to 2^31
+ */
+static inline void delay_cycles(uint32_t cycles) {
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+    delay_cycles_slow(cycles);
+    return;
+  }
+  uint32_t start = DWT->CYCCNT;
+  // Unsigned difference, correct across the counter wrapping
+  while (DWT->CYCCNT - start < cycles)
+    ;
+}
+
+void delay_ns(uint32_t ns);
+void delay_us(uint32_t us);
+void delay_ms(uint32_t ms);
+
+/**
+ * Deadline on the time base, unaffected by clock changes while it runs
+ */
+struct delay_timeout {
+  uint64_t deadlineNs;
+};
+
+void delay_timeout_start_us(struct delay_timeout *timeout, uint32_t us);
+void delay_timeout_start_ms(struct delay_timeout *timeout, uint32_t ms);
+bool delay_timeout_expired(const struct delay_timeout *timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
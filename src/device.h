@@ -0,0 +1,24 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+/**
+ * Core selection for the startup and the modules that only use core
+ * peripherals (SCB, SysTick, DWT, NVIC).
+ *
+ * CORE_M4 (the default) is the STM32F446 with ST's device header. CORE_M7
+ * and CORE_M33 are bare cores as on the Arm MPS2 FPGA images QEMU emulates:
+ * the CMSIS core header with the system exceptions only, see
+ * device_generic.h. Modules using STM32F4 peripherals include stm32f4xx.h
+ * directly and are only built for CORE_M4.
+ */
+
+#if defined(CORE_M7) || defined(CORE_M33)
+#include "device_generic.h"
+#else
+#if !defined(CORE_M4)
+#define CORE_M4
+#endif
+#include "stm32f4xx.h"
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef DEVICE_GENERIC_H
+#define DEVICE_GENERIC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * CMSIS device description of a bare Cortex-M7 or Cortex-M33, matching the
+ * MPS2 AN500 and AN505 images. Only the system exceptions exist, the
+ * configuration follows the Arm reference implementations.
+ */
+
+typedef enum {
+  NonMaskableInt_IRQn = -14,
+  HardFault_IRQn = -13,
+  MemoryManagement_IRQn = -12,
+  BusFault_IRQn = -11,
+  UsageFault_IRQn = -10,
+#if defined(CORE_M33)
+  SecureFault_IRQn = -9,
+#endif
+  SVCall_IRQn = -5,
+  DebugMonitor_IRQn = -4,
+  PendSV_IRQn = -2,
+  SysTick_IRQn = -1,
+} IRQn_Type;
+
+#define __MPU_PRESENT 1U
+#define __FPU_PRESENT 1U
+#define __VTOR_PRESENT 1U
+#define __NVIC_PRIO_BITS 3U
+#define __Vendor_SysTickConfig 0U
+
+#if defined(CORE_M7)
+#define __CM7_REV 0x0101U
+#define __ICACHE_PRESENT 1U
+#define __DCACHE_PRESENT 1U
+#define __DTCM_PRESENT 0U
+#include "core_cm7.h"
+#else
+#define __CM33_REV 0x0000U
+#define __SAUREGION_PRESENT 1U
+#define __DSP_PRESENT 1U
+#include "core_cm33.h"
+#endif
+
+extern uint32_t SystemCoreClock;
+
+void SystemInit(void);
+void SystemCoreClockUpdate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
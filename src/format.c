@@ -0,0 +1,694 @@
+#include "format.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Heap-free printf-style formatter, see format.h
+ */
+
+#if !defined(FORMAT_CONSOLE_CHUNK)
+#define FORMAT_CONSOLE_CHUNK 64
+#endif
+
+#define FLAG_LEFT (1U << 0)
+#define FLAG_PLUS (1U << 1)
+#define FLAG_SPACE (1U << 2)
+#define FLAG_ZERO (1U << 3)
+#define FLAG_ALT (1U << 4)
+#define FLAG_UPPER (1U << 5)
+#define FLAG_PRECISION (1U << 6)
+
+enum length {
+  LENGTH_DEFAULT,
+  LENGTH_CHAR,
+  LENGTH_SHORT,
+  LENGTH_LONG,
+  LENGTH_LONG_LONG,
+  LENGTH_SIZE,
+  LENGTH_MAX,
+  LENGTH_PTRDIFF,
+};
+
+struct output {
+  format_putc_fn putc;
+  void *ctx;
+  int count;
+};
+
+struct buffer {
+  char *buf;
+  size_t size;
+  size_t pos;
+};
+
+struct console {
+  char buf[FORMAT_CONSOLE_CHUNK];
+  int len;
+};
+
+extern int _write(int file, char *ptr, int len);
+
+static void out_char(struct output *out, char ch) {
+  out->putc(ch, out->ctx);
+  out->count++;
+}
+
+static void out_repeat(struct output *out, char ch, int n) {
+  while (n-- > 0) {
+    out_char(out, ch);
+  }
+}
+
+/**
+ * Emits one converted field as
+ * [spaces] prefix [zeros] body [spaces]
+ * where zeros come both from the precision and from the '0' flag
+ */
+static void out_field(struct output *out, const char *prefix,
+                      const char *body, int len, int zeros, int width,
+                      unsigned flags) {
+  int prefixLen = 0;
+  while (prefix[prefixLen]) {
+    prefixLen++;
+  }
+
+  int pad = width - prefixLen - zeros - len;
+  if (!(flags & (FLAG_LEFT | FLAG_ZERO))) {
+    out_repeat(out, ' ', pad);
+  }
+  for (int i = 0; i < prefixLen; i++) {
+    out_char(out, prefix[i]);
+  }
+  if (!(flags & FLAG_LEFT) && (flags & FLAG_ZERO)) {
+    out_repeat(out, '0', pad);
+  }
+  out_repeat(out, '0', zeros);
+  for (int i = 0; i < len; i++) {
+    out_char(out, body[i]);
+  }
+  if (flags & FLAG_LEFT) {
+    out_repeat(out, ' ', pad);
+  }
+}
+
+static void sign_prefix(char *prefix, bool negative, unsigned flags) {
+  if (negative) {
+    *prefix++ = '-';
+  } else if (flags & FLAG_PLUS) {
+    *prefix++ = '+';
+  } else if (flags & FLAG_SPACE) {
+    *prefix++ = ' ';
+  }
+  *prefix = '\0';
+}
+
+static void format_integer(struct output *out, unsigned long long value,
+                           bool negative, unsigned base, int width,
+                           int precision, unsigned flags) {
+  const char *digits =
+      (flags & FLAG_UPPER) ? "0123456789ABCDEF" : "0123456789abcdef";
+  char buf[24];
+  char *end = buf + sizeof(buf);
+  char *p = end;
+
+  // Use 32-bit division whenever possible, 64-bit is a libgcc call on M4
+  if (value <= UINT32_MAX) {
+    uint32_t v = (uint32_t)value;
+    do {
+      *--p = digits[v % base];
+      v /= base;
+    } while (v);
+  } else {
+    // Divide a copy, value is still needed for the zero checks below
+    unsigned long long v = value;
+    do {
+      *--p = digits[v % base];
+      v /= base;
+    } while (v);
+  }
+
+  // An explicit zero precision prints nothing for a zero value
+  if ((flags & FLAG_PRECISION) && precision == 0 && value == 0) {
+    p = end;
+  }
+  int len = end - p;
+  int zeros = (flags & FLAG_PRECISION) && precision > len ? precision - len : 0;
+
+  char prefix[4];
+  sign_prefix(prefix, negative, flags);
+  if ((flags & FLAG_ALT) && base == 16 && value != 0) {
+    prefix[0] = '0';
+    prefix[1] = (flags & FLAG_UPPER) ? 'X' : 'x';
+    prefix[2] = '\0';
+  }
+  if ((flags & FLAG_ALT) && base == 8 && zeros == 0 &&
+      (len == 0 || *p != '0')) {
+    zeros = 1;
+  }
+  // The '0' flag is ignored when a precision is given
+  if (flags & FLAG_PRECISION) {
+    flags &= ~FLAG_ZERO;
+  }
+  out_field(out, prefix, p, len, zeros, width, flags);
+}
+
+static void format_string(struct output *out, const char *str, int width,
+                          int precision, unsigned flags) {
+  if (str == NULL) {
+    str = "(null)";
+  }
+  int len = 0;
+  while (str[len] && (!(flags & FLAG_PRECISION) || len < precision)) {
+    len++;
+  }
+  out_field(out, "", str, len, 0, width, flags & ~FLAG_ZERO);
+}
+
+#if defined(FORMAT_FLOAT)
+
+static const uint32_t pow10[] = {
+    1,      10,      100,      1000,      10000,
+    100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+// Largest precision that still fits the scaled mantissa into 32 bits
+#define FLOAT_MAX_PRECISION 8
+
+static char *put_uint(char *p, uint32_t value, int minDigits) {
+  char tmp[10];
+  int len = 0;
+  do {
+    tmp[len++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+  while (len < minDigits) {
+    tmp[len++] = '0';
+  }
+  while (len) {
+    *p++ = tmp[--len];
+  }
+  return p;
+}
+
+/**
+ * Normalizes value to [1, 10) and returns the decimal exponent
+ */
+static int normalize(float *value) {
+  int exp = 0;
+  if (*value == 0.0f) {
+    return 0;
+  }
+  while (*value >= 1e8f) {
+    *value /= 1e8f;
+    exp += 8;
+  }
+  while (*value >= 10.0f) {
+    *value /= 10.0f;
+    exp++;
+  }
+  while (*value < 1e-8f) {
+    *value *= 1e8f;
+    exp -= 8;
+  }
+  while (*value < 1.0f) {
+    *value *= 10.0f;
+    exp--;
+  }
+  return exp;
+}
+
+/**
+ * Renders the mantissa of value (already normalized to [1, 10)) with the
+ * given number of fractional digits, exponent is adjusted on rounding carry
+ */
+static uint32_t round_mantissa(float value, int precision, int *exp) {
+  uint32_t digits = (uint32_t)(value * (float)pow10[precision] + 0.5f);
+  if (digits >= pow10[precision + 1]) {
+    digits /= 10;
+    (*exp)++;
+  }
+  return digits;
+}
+
+// Largest scale scale_exact() takes: the 24-bit significand times 5^16
+// stays below 2^62
+#define SCALE_EXACT_MAX 16
+
+/**
+ * value * 10^scale rounded half to even, like the C library. Exact while
+ * the result fits 64 bits: value * 10^scale is significand * 5^scale *
+ * 2^(scale - binary exponent), all integers.
+ */
+static uint64_t scale_exact(float value, int scale) {
+  union {
+    float f;
+    uint32_t u;
+  } bits = {value};
+  uint32_t biased = bits.u >> 23 & 0xFF;
+  uint64_t num = bits.u & 0x7FFFFF;
+  int shift = 149;
+  if (biased) {
+    num |= 1U << 23;
+    shift = 150 - (int)biased;
+  }
+
+  uint64_t den = 1;
+  for (int i = 0; i < scale; i++) {
+    num *= 5;
+  }
+  for (int i = 0; i > scale; i--) {
+    den *= 5;
+  }
+  int exp2 = scale - shift;
+  if (exp2 >= 0) {
+    num <<= exp2;
+  } else if (exp2 > -63) {
+    den <<= -exp2;
+  } else {
+    // Below 2^62 / 2^63, rounds to 0
+    return 0;
+  }
+  uint64_t result = num / den;
+  uint64_t rest = num % den;
+  if (rest * 2 > den || (rest * 2 == den && (result & 1))) {
+    result++;
+  }
+  return result;
+}
+
+/**
+ * Rounds value to `digits` significant digits, returned as a number of
+ * that many digits with *exp the decimal exponent of the first one
+ */
+static uint32_t round_significant(float value, int digits, int *exp) {
+  float normalized = value;
+  *exp = normalize(&normalized);
+  int scale = digits - 1 - *exp;
+  if (value == 0.0f || value >= 4294967295.0f || scale > SCALE_EXACT_MAX) {
+    return round_mantissa(normalized, digits - 1, exp);
+  }
+
+  // Each division of normalize() rounds, so its exponent may be one off:
+  // checked against the exactly scaled value
+  uint64_t scaled = scale_exact(value, scale);
+  if (scaled < pow10[digits - 1] && scale < SCALE_EXACT_MAX) {
+    (*exp)--;
+    scaled = scale_exact(value, ++scale);
+  }
+  if (scaled >= pow10[digits]) {
+    // Carry into a new digit, or the exponent was one too low
+    (*exp)++;
+    scaled = scale > 0 ? scale_exact(value, scale - 1) : (scaled + 5) / 10;
+  }
+  return (uint32_t)scaled;
+}
+
+static char *put_fixed(char *p, float value, int precision, unsigned flags) {
+  // %g of small values asks for more fractional digits than 32 bits can hold
+  if (precision > 9) {
+    precision = 9;
+  }
+  uint64_t scaled = scale_exact(value, precision);
+  p = put_uint(p, (uint32_t)(scaled / pow10[precision]), 1);
+  if (precision > 0 || (flags & FLAG_ALT)) {
+    *p++ = '.';
+  }
+  if (precision > 0) {
+    p = put_uint(p, (uint32_t)(scaled % pow10[precision]), precision);
+  }
+  return p;
+}
+
+static char *put_exponent(char *p, uint32_t mantissa, int precision, int exp,
+                          unsigned flags) {
+  p = put_uint(p, mantissa / pow10[precision], 1);
+  if (precision > 0 || (flags & FLAG_ALT)) {
+    *p++ = '.';
+  }
+  if (precision > 0) {
+    p = put_uint(p, mantissa % pow10[precision], precision);
+  }
+  *p++ = (flags & FLAG_UPPER) ? 'E' : 'e';
+  *p++ = exp < 0 ? '-' : '+';
+  return put_uint(p, exp < 0 ? -exp : exp, 2);
+}
+
+static char *strip_zeros(char *start, char *p) {
+  char *dot = start;
+  while (dot < p && *dot != '.') {
+    dot++;
+  }
+  if (dot == p) {
+    return p;
+  }
+  while (p > dot + 1 && p[-1] == '0') {
+    p--;
+  }
+  if (p == dot + 1) {
+    p--;
+  }
+  return p;
+}
+
+static void format_float(struct output *out, float value, char conv,
+                         int width, int precision, unsigned flags) {
+  char buf[32];
+  char *p = buf;
+  char prefix[2];
+  bool negative = __builtin_signbit(value);
+
+  if (negative) {
+    value = -value;
+  }
+  sign_prefix(prefix, negative, flags);
+
+  if (value != value || value > 3.4028235e38f) {
+    const char *text = value != value ? "nan" : "inf";
+    for (int i = 0; i < 3; i++) {
+      buf[i] = (flags & FLAG_UPPER) ? text[i] - 'a' + 'A' : text[i];
+    }
+    out_field(out, prefix, buf, 3, 0, width, flags & ~FLAG_ZERO);
+    return;
+  }
+
+  if (!(flags & FLAG_PRECISION)) {
+    precision = 6;
+  }
+  if (precision > FLOAT_MAX_PRECISION) {
+    precision = FLOAT_MAX_PRECISION;
+  }
+
+  if (conv == 'g') {
+    int significant = precision == 0 ? 1 : precision;
+    int exp;
+    uint32_t mantissa = round_significant(value, significant, &exp);
+    if (exp >= -4 && exp < significant) {
+      p = put_fixed(p, value, significant - 1 - exp, flags);
+    } else {
+      p = put_exponent(p, mantissa, significant - 1, exp, flags);
+    }
+    if (!(flags & FLAG_ALT)) {
+      // Keep the exponent suffix while stripping the fractional zeros
+      char *suffix = buf;
+      while (suffix < p && *suffix != 'e' && *suffix != 'E') {
+        suffix++;
+      }
+      char *end = strip_zeros(buf, suffix);
+      while (suffix < p) {
+        *end++ = *suffix++;
+      }
+      p = end;
+    }
+  } else if (conv == 'f' && value < 4294967295.0f) {
+    p = put_fixed(p, value, precision, flags);
+  } else {
+    // %e, and %f values out of 32-bit range
+    int exp;
+    uint32_t mantissa = round_significant(value, precision + 1, &exp);
+    p = put_exponent(p, mantissa, precision, exp, flags);
+  }
+
+  out_field(out, prefix, buf, p - buf, 0, width, flags);
+}
+
+#endif
+
+int format_vcallback(format_putc_fn putc, void *ctx, const char *fmt,
+                     va_list args) {
+  struct output out = {putc, ctx, 0};
+  va_list ap;
+  va_copy(ap, args);
+
+  while (*fmt) {
+    if (*fmt != '%') {
+      out_char(&out, *fmt++);
+      continue;
+    }
+    fmt++;
+
+    // Flags
+    unsigned flags = 0;
+    for (bool more = true; more;) {
+      switch (*fmt) {
+      case '-':
+        flags |= FLAG_LEFT;
+        break;
+      case '+':
+        flags |= FLAG_PLUS;
+        break;
+      case ' ':
+        flags |= FLAG_SPACE;
+        break;
+      case '0':
+        flags |= FLAG_ZERO;
+        break;
+      case '#':
+        flags |= FLAG_ALT;
+        break;
+      default:
+        more = false;
+        continue;
+      }
+      fmt++;
+    }
+
+    // Width
+    int width = 0;
+    if (*fmt == '*') {
+      width = va_arg(ap, int);
+      if (width < 0) {
+        flags |= FLAG_LEFT;
+        width = -width;
+      }
+      fmt++;
+    }
+    while (*fmt >= '0' && *fmt <= '9') {
+      width = width * 10 + (*fmt++ - '0');
+    }
+
+    // Precision
+    int precision = 0;
+    if (*fmt == '.') {
+      flags |= FLAG_PRECISION;
+      fmt++;
+      if (*fmt == '*') {
+        precision = va_arg(ap, int);
+        if (precision < 0) {
+          flags &= ~FLAG_PRECISION;
+          precision = 0;
+        }
+        fmt++;
+      }
+      while (*fmt >= '0' && *fmt <= '9') {
+        precision = precision * 10 + (*fmt++ - '0');
+      }
+    }
+
+    // Length modifier
+    enum length length = LENGTH_DEFAULT;
+    switch (*fmt) {
+    case 'h':
+      length = LENGTH_SHORT;
+      if (*++fmt == 'h') {
+        length = LENGTH_CHAR;
+        fmt++;
+      }
+      break;
+    case 'l':
+      length = LENGTH_LONG;
+      if (*++fmt == 'l') {
+        length = LENGTH_LONG_LONG;
+        fmt++;
+      }
+      break;
+    case 'z':
+      length = LENGTH_SIZE;
+      fmt++;
+      break;
+    case 'j':
+      length = LENGTH_MAX;
+      fmt++;
+      break;
+    case 't':
+      length = LENGTH_PTRDIFF;
+      fmt++;
+      break;
+    default:
+      break;
+    }
+
+    char conv = *fmt;
+    if (conv == '\0') {
+      break;
+    }
+    fmt++;
+
+    switch (conv) {
+    case 'd':
+    case 'i': {
+      long long value;
+      switch (length) {
+      case LENGTH_CHAR:
+        value = (signed char)va_arg(ap, int);
+        break;
+      case LENGTH_SHORT:
+        value = (short)va_arg(ap, int);
+        break;
+      case LENGTH_LONG:
+        value = va_arg(ap, long);
+        break;
+      case LENGTH_LONG_LONG:
+        value = va_arg(ap, long long);
+        break;
+      case LENGTH_SIZE:
+      case LENGTH_PTRDIFF:
+        value = va_arg(ap, ptrdiff_t);
+        break;
+      case LENGTH_MAX:
+        value = va_arg(ap, intmax_t);
+        break;
+      default:
+        value = va_arg(ap, int);
+        break;
+      }
+      unsigned long long magnitude =
+          value < 0 ? -(unsigned long long)value : (unsigned long long)value;
+      format_integer(&out, magnitude, value < 0, 10, width, precision, flags);
+      break;
+    }
+    case 'X':
+      flags |= FLAG_UPPER;
+      // fall through
+    case 'u':
+    case 'x':
+    case 'o': {
+      unsigned long long value;
+      switch (length) {
+      case LENGTH_CHAR:
+        value = (unsigned char)va_arg(ap, unsigned);
+        break;
+      case LENGTH_SHORT:
+        value = (unsigned short)va_arg(ap, unsigned);
+        break;
+      case LENGTH_LONG:
+        value = va_arg(ap, unsigned long);
+        break;
+      case LENGTH_LONG_LONG:
+        value = va_arg(ap, unsigned long long);
+        break;
+      case LENGTH_SIZE:
+      case LENGTH_PTRDIFF:
+        value = va_arg(ap, size_t);
+        break;
+      case LENGTH_MAX:
+        value = va_arg(ap, uintmax_t);
+        break;
+      default:
+        value = va_arg(ap, unsigned);
+        break;
+      }
+      unsigned base = conv == 'o' ? 8 : conv == 'u' ? 10 : 16;
+      format_integer(&out, value, false, base, width, precision,
+                     flags & ~(FLAG_PLUS | FLAG_SPACE));
+      break;
+    }
+    case 'p':
+      format_integer(&out, (uintptr_t)va_arg(ap, void *), false, 16, width,
+                     precision, (flags | FLAG_ALT) & ~(FLAG_PLUS | FLAG_SPACE));
+      break;
+    case 'c': {
+      char ch = (char)va_arg(ap, int);
+      out_field(&out, "", &ch, 1, 0, width, flags & ~FLAG_ZERO);
+      break;
+    }
+    case 's':
+      format_string(&out, va_arg(ap, const char *), width, precision, flags);
+      break;
+#if defined(FORMAT_FLOAT)
+    case 'E':
+    case 'F':
+    case 'G':
+      flags |= FLAG_UPPER;
+      conv += 'a' - 'A';
+      // fall through
+    case 'e':
+    case 'f':
+    case 'g':
+      // Single precision is what the FPU computes in hardware
+      format_float(&out, (float)va_arg(ap, double), conv, width, precision,
+                   flags);
+      break;
+#endif
+    case '%':
+      out_char(&out, '%');
+      break;
+    default:
+      // Unknown conversion, echo it back
+      out_char(&out, '%');
+      out_char(&out, conv);
+      break;
+    }
+  }
+
+  va_end(ap);
+  return out.count;
+}
+
+int format_callback(format_putc_fn putc, void *ctx, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int count = format_vcallback(putc, ctx, fmt, args);
+  va_end(args);
+  return count;
+}
+
+static void buffer_putc(char ch, void *ctx) {
+  struct buffer *buffer = ctx;
+  if (buffer->pos + 1 < buffer->size) {
+    buffer->buf[buffer->pos++] = ch;
+  }
+}
+
+int format_vsnprintf(char *buf, size_t size, const char *fmt, va_list args) {
+  struct buffer buffer = {buf, size, 0};
+  int count = format_vcallback(buffer_putc, &buffer, fmt, args);
+  if (size > 0) {
+    buf[buffer.pos] = '\0';
+  }
+  return count;
+}
+
+int format_snprintf(char *buf, size_t size, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int count = format_vsnprintf(buf, size, fmt, args);
+  va_end(args);
+  return count;
+}
+
+static void console_putc(char ch, void *ctx) {
+  struct console *console = ctx;
+  console->buf[console->len++] = ch;
+  if (console->len == FORMAT_CONSOLE_CHUNK) {
+    _write(1, console->buf, console->len);
+    console->len = 0;
+  }
+}
+
+int format_vprintf(const char *fmt, va_list args) {
+  struct console console;
+  console.len = 0;
+  int count = format_vcallback(console_putc, &console, fmt, args);
+  if (console.len > 0) {
+    _write(1, console.buf, console.len);
+  }
+  return count;
+}
+
+int format_printf(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int count = format_vprintf(fmt, args);
+  va_end(args);
+  return count;
+}
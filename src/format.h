@@ -0,0 +1,63 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Heap-free formatted output.
+ *
+ * Unlike newlib-nano printf, the formatter keeps no global state and never
+ * calls malloc, so it can be used from interrupt handlers and re-entered.
+ * Supported conversions: %c %s %d %i %u %x %X %o %p %% with flags, width,
+ * precision and the hh/h/l/ll/z/j/t length modifiers.
+ *
+ * Floating point (%f %e %g) is compiled in with FORMAT_FLOAT. Arguments
+ * are converted to float and the precision is capped at 8. Values below
+ * 2^32 are rounded exactly like the C library (ties to even) with 64-bit
+ * integers: %f always, %e and %g down to about 1e-10 at the default
+ * precision. Smaller values are scaled on the FPU and only about 7
+ * significant digits are exact. %f of values from 2^32 on prints exponent
+ * form like %e.
+ */
+
+/**
+ * Output sink, called once per produced character
+ */
+typedef void (*format_putc_fn)(char ch, void *ctx);
+
+/**
+ * Formats into an arbitrary sink
+ *
+ * @return Number of characters produced
+ */
+int format_vcallback(format_putc_fn putc, void *ctx, const char *fmt,
+                     va_list args);
+int format_callback(format_putc_fn putc, void *ctx, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Formats into a caller buffer, always NUL-terminated when size > 0
+ *
+ * @return Number of characters the full output would take, like snprintf()
+ */
+int format_vsnprintf(char *buf, size_t size, const char *fmt, va_list args);
+int format_snprintf(char *buf, size_t size, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Formats to the console (stdout file descriptor of _write()), buffering
+ * output in FORMAT_CONSOLE_CHUNK bytes of stack
+ */
+int format_vprintf(const char *fmt, va_list args);
+int format_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
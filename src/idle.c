@@ -0,0 +1,100 @@
+#include "idle.h"
+#include "device.h"
+#include "timebase.h"
+
+/**
+ * Tickless idle, see idle.h
+ */
+
+// A tick boundary closer than this after wakeup is treated as reached, the
+// shortened SysTick period has to outlast its own reprogramming
+#define RESTART_MARGIN_CYCLES 64U
+
+void idle_wait(void) {
+  __DSB();
+  __WFI();
+}
+
+void idle_sleep(uint32_t ms) {
+  uint32_t tickCycles = SysTick->LOAD + 1;
+  if (!(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) ||
+      !timebase_has_cycle_counter() || ms == 0) {
+    idle_wait();
+    return;
+  }
+
+  // Longest sleep SysTick can time at the current clock
+  uint32_t maxTicks = (SysTick_LOAD_RELOAD_Msk + 1) / tickCycles;
+  uint32_t sleepTicks = ms;
+  if (TIMEBASE_TICK_HZ != 1000 || sleepTicks > maxTicks) {
+    uint64_t requested = (uint64_t)ms * TIMEBASE_TICK_HZ / 1000;
+    sleepTicks = requested > maxTicks ? maxTicks : (uint32_t)requested;
+  }
+  if (sleepTicks <= 1) {
+    // Not worth reprogramming for less than the next tick
+    idle_wait();
+    return;
+  }
+
+  // Interrupts stay masked across WFI: a pending one still wakes the core,
+  // but runs only after SysTick is restored below
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  // Continue from where the current tick period is
+  uint32_t intoTick = tickCycles - 1 - SysTick->VAL;
+  SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+  if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+    // A tick is due (masked by the caller, or the counter wrapped since the
+    // checks above): WFI would return at once and the tick get cleared
+    // below. Leave it to the handler and sleep on the next call.
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    __set_PRIMASK(primask);
+    return;
+  }
+  SysTick->LOAD = sleepTicks * tickCycles - 1 - intoTick;
+  SysTick->VAL = 0;
+  uint32_t cyclesBefore = DWT->CYCCNT;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+  __DSB();
+  __WFI();
+
+  uint32_t ctrl = SysTick->CTRL;
+  uint32_t remaining = SysTick->VAL;
+  uint32_t counted = DWT->CYCCNT - cyclesBefore;
+  SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+  // Cycles since SysTick was restarted. Past the long period's expiry the
+  // counter went on from the reload value.
+  uint32_t load = SysTick->LOAD;
+  uint32_t elapsed = (ctrl & SysTick_CTRL_COUNTFLAG_Msk)
+                         ? load + 1 + (load - remaining)
+                         : load - remaining;
+
+  // The long period's expiry is accounted for here, not by the handler
+  SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+
+  // The tick period the sleep started in goes on: whole periods since its
+  // start are counted, the partial one delays the next tick
+  uint32_t sinceTick = intoTick + elapsed;
+  uint32_t ticksElapsed = sinceTick / tickCycles;
+  uint32_t toNextTick = tickCycles - sinceTick % tickCycles;
+  if (toNextTick < RESTART_MARGIN_CYCLES) {
+    // Let the handler count the boundary that is due right now
+    SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+    toNextTick += tickCycles;
+  }
+
+  // One shortened period to stay in phase, then the regular one, which
+  // SysTick takes at its next reload
+  SysTick->LOAD = toNextTick - 1;
+  SysTick->VAL = 0;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+  while (SysTick->VAL == 0) {
+  }
+  SysTick->LOAD = tickCycles - 1;
+
+  timebase_resync(elapsed, counted, ticksElapsed);
+  __set_PRIMASK(primask);
+}
@@ -0,0 +1,38 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Low-power idling in Sleep mode.
+ *
+ * idle_sleep() stops the regular SysTick interrupt for as long as the
+ * caller has nothing to do (bounded by the 24-bit SysTick reload), so the
+ * core is not woken up every tick just to count time. The time base is
+ * corrected on wakeup.
+ */
+
+#define IDLE_FOREVER UINT32_MAX
+
+/**
+ * Sleeps until the next interrupt, SysTick included
+ */
+void idle_wait(void);
+
+/**
+ * Sleeps until an interrupt arrives or `ms` milliseconds have passed,
+ * whichever comes first. Without the time base running, or with SysTick
+ * counting its cycles, it falls back to idle_wait(). Returns at once when
+ * a tick is already pending, so the handler still counts it.
+ */
+void idle_sleep(uint32_t ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,153 @@
+#include "log.h"
+#include "format.h"
+#include "device.h"
+#include "timebase.h"
+#include <stdbool.h>
+
+/**
+ * Rate-limited log router, see log.h
+ */
+
+// Bucket content is kept in thousandths of a token so slow rates refill
+// smoothly
+#define TOKEN 1000U
+
+struct channel {
+  bool configured;
+  struct log_channel_config config;
+  uint32_t tokens;
+  uint64_t lastRefillUs;
+  struct log_stats stats;
+  // drops not reported in the output yet
+  uint32_t unreported;
+};
+
+static struct channel channels[LOG_MAX_CHANNELS];
+
+static const char *const levelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+extern int _write(int file, char *ptr, int len);
+
+void log_channel_configure(unsigned channel,
+                           const struct log_channel_config *config) {
+  if (channel >= LOG_MAX_CHANNELS) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  channels[channel].configured = true;
+  channels[channel].config = *config;
+  channels[channel].tokens = config->burst * TOKEN;
+  channels[channel].lastRefillUs = timebase_ns() / 1000;
+  __set_PRIMASK(primask);
+}
+
+void log_get_stats(unsigned channel, struct log_stats *stats) {
+  if (channel >= LOG_MAX_CHANNELS) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = channels[channel].stats;
+  __set_PRIMASK(primask);
+}
+
+/**
+ * Refills the bucket and takes one token, interrupts must be masked
+ */
+static bool take_token(struct channel *ch, uint64_t nowUs) {
+  const struct log_channel_config *config = &ch->config;
+  if (config->ratePerSec == 0) {
+    return true;
+  }
+
+  uint64_t elapsedUs =
+      nowUs > ch->lastRefillUs ? nowUs - ch->lastRefillUs : 0;
+  uint64_t refill = elapsedUs * config->ratePerSec / 1000;
+  uint32_t capacity = config->burst * TOKEN;
+  if (refill >= capacity - ch->tokens) {
+    ch->tokens = capacity;
+    ch->lastRefillUs = nowUs;
+  } else if (refill > 0) {
+    ch->tokens += refill;
+    // Only the time the added tokens stand for, the rest of elapsedUs is
+    // still owed to the next refill
+    ch->lastRefillUs += refill * 1000 / config->ratePerSec;
+  }
+
+  if (ch->tokens < TOKEN) {
+    return false;
+  }
+  ch->tokens -= TOKEN;
+  return true;
+}
+
+int log_write(unsigned channel, enum log_level level, const char *fmt, ...) {
+  static const struct log_channel_config defaults = {NULL, LOG_LEVEL_INFO, 1,
+                                                     0, 0};
+  if (channel >= LOG_MAX_CHANNELS) {
+    return 0;
+  }
+  struct channel *ch = &channels[channel];
+  const struct log_channel_config *config =
+      ch->configured ? &ch->config : &defaults;
+  if (level < config->minLevel) {
+    return 0;
+  }
+
+  uint32_t unreported = 0;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  // Read under the lock: a preempting logger must not refill the bucket
+  // with a later time than ours
+  uint64_t nowNs = timebase_ns();
+  bool accepted = take_token(ch, nowNs / 1000);
+  if (accepted) {
+    ch->stats.emitted++;
+    unreported = ch->unreported;
+    ch->unreported = 0;
+  } else {
+    ch->stats.dropped++;
+    ch->unreported++;
+  }
+  __set_PRIMASK(primask);
+
+  if (!accepted) {
+    return 0;
+  }
+
+  // Formatting happens outside the critical section, on the caller's stack
+  char line[LOG_LINE_SIZE];
+  int len = 0;
+  uint32_t ms = nowNs / 1000000;
+  if (unreported > 0) {
+    len = format_snprintf(line, sizeof(line), "[%lu] WARN %u: %lu dropped\n",
+                          (unsigned long)ms, channel,
+                          (unsigned long)unreported);
+    _write(config->fd, line, len < LOG_LINE_SIZE ? len : LOG_LINE_SIZE - 1);
+  }
+
+  if (config->name != NULL) {
+    len = format_snprintf(line, sizeof(line), "[%lu] %s %s: ",
+                          (unsigned long)ms, levelNames[level], config->name);
+  } else {
+    len = format_snprintf(line, sizeof(line), "[%lu] %s %u: ",
+                          (unsigned long)ms, levelNames[level], channel);
+  }
+  if (len < LOG_LINE_SIZE - 1) {
+    va_list args;
+    va_start(args, fmt);
+    len += format_vsnprintf(line + len, sizeof(line) - len, fmt, args);
+    va_end(args);
+  }
+
+  // Truncated messages still end the line
+  if (len > LOG_LINE_SIZE - 2) {
+    len = LOG_LINE_SIZE - 2;
+  }
+  line[len++] = '\n';
+  _write(config->fd, line, len);
+
+  return 1;
+}
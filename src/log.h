@@ -0,0 +1,73 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Channel-based logging on top of _write().
+ *
+ * Every channel has a minimum severity, a destination file descriptor and
+ * a token bucket: a message costs one token, tokens refill at ratePerSec up
+ * to burst. Messages finding an empty bucket are only counted, so a storm
+ * on one channel costs a few cycles per message instead of console time.
+ */
+
+#if !defined(LOG_MAX_CHANNELS)
+#define LOG_MAX_CHANNELS 8
+#endif
+
+#if !defined(LOG_LINE_SIZE)
+#define LOG_LINE_SIZE 128
+#endif
+
+enum log_level {
+  LOG_LEVEL_DEBUG,
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_ERROR,
+};
+
+struct log_channel_config {
+  const char *name;
+  enum log_level minLevel;
+  // destination for _write(), 1 is the console
+  int fd;
+  // 0 disables rate limiting
+  uint32_t ratePerSec;
+  uint32_t burst;
+};
+
+struct log_stats {
+  uint32_t emitted;
+  uint32_t dropped;
+};
+
+/**
+ * Unconfigured channels log everything at INFO and above to the console
+ * without a rate limit
+ */
+void log_channel_configure(unsigned channel,
+                           const struct log_channel_config *config);
+
+void log_get_stats(unsigned channel, struct log_stats *stats);
+
+/**
+ * @return 1 if the message was written, 0 if filtered or dropped
+ */
+int log_write(unsigned channel, enum log_level level, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define LOG_DEBUG(channel, ...) log_write(channel, LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(channel, ...) log_write(channel, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(channel, ...) log_write(channel, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(channel, ...) log_write(channel, LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+#include "lowpower.h"
+#include "clock.h"
+#include "clock_gate.h"
+#include "stm32f4xx.h"
+#include "timebase.h"
+
+/**
+ * STOP mode handling, see lowpower.h
+ */
+
+#define STOP_BITS                                                              \
+  (PWR_CR_PDDS | PWR_CR_LPDS | PWR_CR_FPDS | PWR_CR_LPLVDS | PWR_CR_MRLVDS)
+
+static struct lowpower_stats stats = {.minWakeNs = UINT32_MAX};
+
+static uint32_t stop_bits(const struct lowpower_stop_config *config) {
+  uint32_t bits = config->flashPowerDown ? PWR_CR_FPDS : 0;
+  switch (config->regulator) {
+  case LOWPOWER_REGULATOR_MAIN_LOW_VOLTAGE:
+    return bits | PWR_CR_MRLVDS;
+  case LOWPOWER_REGULATOR_LOW_POWER:
+    return bits | PWR_CR_LPDS;
+  case LOWPOWER_REGULATOR_LOW_POWER_LOW_VOLTAGE:
+    return bits | PWR_CR_LPDS | PWR_CR_LPLVDS;
+  default:
+    return bits;
+  }
+}
+
+static void record_wake(uint32_t ns) {
+  stats.stops++;
+  stats.lastWakeNs = ns;
+  stats.totalWakeNs += ns;
+  if (ns < stats.minWakeNs) {
+    stats.minWakeNs = ns;
+  }
+  if (ns > stats.maxWakeNs) {
+    stats.maxWakeNs = ns;
+  }
+}
+
+int lowpower_stop(const struct lowpower_stop_config *config) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  enum clock_perf_point point = clock_get_perf_point();
+  uint32_t bits = stop_bits(config);
+  if ((bits & (PWR_CR_MRLVDS | PWR_CR_LPLVDS)) &&
+      point != CLOCK_PERF_HSI_16MHZ &&
+      clock_set_perf_point(CLOCK_PERF_HSI_16MHZ) != 0) {
+    __set_PRIMASK(primask);
+    return -1;
+  }
+
+  // A pending tick would make WFI return without stopping, and SysTick
+  // halts in STOP anyway. A tick already due is handed back afterwards.
+  uint32_t sysTickCtrl = SysTick->CTRL;
+  SysTick->CTRL = sysTickCtrl & ~SysTick_CTRL_ENABLE_Msk;
+  bool tickDue = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+  SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+
+  clock_gate_acquire(CLOCK_GATE(APB1, PWR), false);
+  PWR->CR = (PWR->CR & ~STOP_BITS) | bits | PWR_CR_CWUF;
+  clock_gate_release(CLOCK_GATE(APB1, PWR), false);
+  // STOP wakes up on HSI with the PLL off. Stopping from HSI changes no
+  // clock, there only an interrupt pending before WFI, which keeps the
+  // device out of STOP, tells.
+  bool fromHsi = (RCC->CFGR & RCC_CFGR_SWS) == RCC_CFGR_SWS_HSI;
+  bool pending = SCB->ICSR & SCB_ICSR_ISRPENDING_Msk;
+  SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+
+  __DSB();
+  __WFI();
+
+  SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+  SysTick->CTRL = sysTickCtrl;
+  if (tickDue) {
+    SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+  }
+
+  bool stopped = fromHsi ? !pending
+                         : (RCC->CFGR & RCC_CFGR_SWS) == RCC_CFGR_SWS_HSI;
+
+  // Back on HSI with the PLL and over-drive off, tell the time base first
+  // so the restore below is measured at the right rate
+  clock_tree_update();
+  timebase_clock_update();
+  uint64_t wakeNs = timebase_ns();
+
+  int result = clock_set_perf_point(point);
+
+  if (stopped) {
+    record_wake((uint32_t)(timebase_ns() - wakeNs));
+  }
+  __set_PRIMASK(primask);
+  return result;
+}
+
+void lowpower_get_stats(struct lowpower_stats *out) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *out = stats;
+  __set_PRIMASK(primask);
+}
+
+void lowpower_reset_stats(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  stats = (struct lowpower_stats){.minWakeNs = UINT32_MAX};
+  __set_PRIMASK(primask);
+}
@@ -0,0 +1,74 @@
+#ifndef LOWPOWER_H
+#define LOWPOWER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * STOP mode entry and exit.
+ *
+ * In STOP all clocks halt, SRAM and registers are retained, and any EXTI
+ * line configured by the caller (pins, RTC, ...) wakes the device up on
+ * HSI. lowpower_stop() then re-locks the PLL into the performance point
+ * that was active before and measures how long that took with the cycle
+ * counter. Deeper regulator settings draw less current in STOP but take
+ * longer to wake up, the statistics show what a setting costs.
+ *
+ * The time base does not advance while the device is stopped.
+ */
+
+enum lowpower_regulator {
+  // Main regulator stays on, fastest wakeup
+  LOWPOWER_REGULATOR_MAIN,
+  // Main regulator in low-voltage mode
+  LOWPOWER_REGULATOR_MAIN_LOW_VOLTAGE,
+  // Low-power regulator
+  LOWPOWER_REGULATOR_LOW_POWER,
+  // Low-power regulator in low-voltage mode, lowest current
+  LOWPOWER_REGULATOR_LOW_POWER_LOW_VOLTAGE,
+};
+
+struct lowpower_stop_config {
+  enum lowpower_regulator regulator;
+  // Power the flash down too, adds its restart to the wakeup
+  bool flashPowerDown;
+};
+
+/**
+ * Wake-to-ready latencies, from the first instruction after wakeup until
+ * the clock tree is restored. The regulator and flash restart before the
+ * core runs again is not included. Calls that returned without entering
+ * STOP, because an interrupt was already pending, are not counted.
+ */
+struct lowpower_stats {
+  uint32_t stops;
+  uint32_t lastWakeNs;
+  uint32_t minWakeNs;
+  uint32_t maxWakeNs;
+  uint64_t totalWakeNs;
+};
+
+/**
+ * Enters STOP until a wakeup event arrives. Interrupts are masked across
+ * the call, so the handler of the wakeup source runs only once the clocks
+ * are back. The low-voltage settings require voltage scale 3, the system
+ * clock is dropped to HSI before stopping in that case.
+ *
+ * @return 0 on success, -1 if the previous performance point could not be
+ *         restored (the device then runs on HSI)
+ */
+int lowpower_stop(const struct lowpower_stop_config *config);
+
+void lowpower_get_stats(struct lowpower_stats *stats);
+
+void lowpower_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
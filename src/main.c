@@ -3,6 +3,14 @@
  * loaded and what memory sections are being used.
  */
 
+#include "idle.h"
+#if defined(BENCHMARK)
+#include "bench.h"
+#endif
+#if defined(BOOT_BENCH)
+#include "boot_bench.h"
+#endif
+
 // .bss (RAM)
 static int static_bss_int;
 // .data (FLASH -> RAM)
@@ -27,6 +35,20 @@ union my_union {
 
 // .text (FLASH)
 int main() {
+#if defined(BOOT_BENCH) || defined(BENCHMARK)
+  // Measurement builds report to the console and leave, a boot time
+  // regression or a failed check fails the QEMU run
+  int status = 0;
+#if defined(BOOT_BENCH)
+  status = boot_bench_report(1);
+#endif
+#if defined(BENCHMARK)
+  if (bench_run_all(1) < 0) {
+    status = 1;
+  }
+#endif
+  return status;
+#endif
 
   // ._user_heap_stack (RAM)
   unsigned short int stack_int = 1;
@@ -45,8 +67,13 @@ int main() {
                     stack_int + bss_my_struct.a +
                     bss_my_union.b;
 
+#if !defined(SEMIHOSTING)
+  // Nothing else to do, sleep with SysTick suppressed. With semihosting
+  // returning ends the session instead.
   while (1) {
+    idle_sleep(IDLE_FOREVER);
   }
+#endif
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "pcsample.h"
+#include "stm32f4xx.h"
+
+/**
+ * DWT PC sampling, see pcsample.h
+ */
+
+// CYCCNT bit the sample counter is clocked from, 6 or 10 (CYCTAP)
+#define TAP_SHORT 64U
+#define TAP_LONG 1024U
+#define POSTCNT_MAX 16U
+
+// Unlocks the ITM registers for writing
+#define ITM_LAR_KEY 0xC5ACCE55U
+
+// TPIU selected pin protocol: asynchronous NRZ (UART)
+#define TPI_SPPR_NRZ 2U
+
+void pcsample_start(uint32_t swoHz, uint32_t interval) {
+  // Trace pins in asynchronous mode, SWO only
+  DBGMCU->CR = (DBGMCU->CR & ~DBGMCU_CR_TRACE_MODE_Msk) | DBGMCU_CR_TRACE_IOEN;
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+
+  TPI->SPPR = TPI_SPPR_NRZ;
+  TPI->ACPR = SystemCoreClock / swoHz - 1;
+  // Raw ITM packets, no TPIU framing
+  TPI->FFCR = TPI_FFCR_TrigIn_Msk;
+
+  ITM->LAR = ITM_LAR_KEY;
+  ITM->TCR = (1U << ITM_TCR_TraceBusID_Pos) | ITM_TCR_SYNCENA_Msk |
+             ITM_TCR_DWTENA_Msk | ITM_TCR_ITMENA_Msk;
+
+  // One sample per (POSTPRESET + 1) taps
+  uint32_t tap = interval > TAP_SHORT * POSTCNT_MAX ? TAP_LONG : TAP_SHORT;
+  uint32_t count = interval / tap;
+  if (count < 1) {
+    count = 1;
+  } else if (count > POSTCNT_MAX) {
+    count = POSTCNT_MAX;
+  }
+
+  uint32_t ctrl = DWT->CTRL & ~(DWT_CTRL_POSTPRESET_Msk | DWT_CTRL_POSTINIT_Msk |
+                                DWT_CTRL_CYCTAP_Msk | DWT_CTRL_PCSAMPLENA_Msk);
+  ctrl |= (count - 1) << DWT_CTRL_POSTPRESET_Pos;
+  ctrl |= (count - 1) << DWT_CTRL_POSTINIT_Pos;
+  if (tap == TAP_LONG) {
+    ctrl |= DWT_CTRL_CYCTAP_Msk;
+  }
+  DWT->CTRL = ctrl | DWT_CTRL_CYCCNTENA_Msk;
+  DWT->CTRL = ctrl | DWT_CTRL_CYCCNTENA_Msk | DWT_CTRL_PCSAMPLENA_Msk;
+}
+
+void pcsample_stop(void) {
+  DWT->CTRL &= ~DWT_CTRL_PCSAMPLENA_Msk;
+  // Let the last packets drain before the caller reconfigures anything
+  while (ITM->TCR & ITM_TCR_BUSY_Msk) {
+  }
+}
@@ -0,0 +1,34 @@
+#ifndef PCSAMPLE_H
+#define PCSAMPLE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Statistical profiling with DWT PC sampling over SWO.
+ *
+ * Every `interval` core cycles the DWT emits the program counter as an ITM
+ * hardware source packet, the TPIU sends them out of the SWO pin (PB3,
+ * TRACESWO after reset). Capture the raw stream with the debugger and rank
+ * the functions with tools/hot_placement.py --swo.
+ *
+ * The debugger only has to capture SWO at `swoHz`. Sampling costs no CPU
+ * time, but it stops while the core sleeps.
+ */
+
+/**
+ * Starts sampling, `interval` is rounded to what the DWT supports (64 to
+ * 1024 cycles in steps of 64, 1024 to 16384 in steps of 1024)
+ */
+void pcsample_start(uint32_t swoHz, uint32_t interval);
+
+void pcsample_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
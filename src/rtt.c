@@ -0,0 +1,108 @@
+#include "rtt.h"
+#include "device.h"
+
+/**
+ * Memory-ring console, see rtt.h
+ */
+
+static char rtt_up_data[RTT_UP_BUFFER_SIZE];
+static char rtt_down_data[RTT_DOWN_BUFFER_SIZE];
+
+struct rtt_control_block rtt_control_block;
+
+void rtt_init(void) {
+  static const char magic[] = "SEGGER RTT";
+  struct rtt_control_block *cb = &rtt_control_block;
+
+  cb->maxUpBuffers = 1;
+  cb->maxDownBuffers = 1;
+  cb->up[0] = (struct rtt_buffer){"Terminal", rtt_up_data,
+                                  RTT_UP_BUFFER_SIZE, 0, 0, 0};
+  cb->down[0] = (struct rtt_buffer){"Terminal", rtt_down_data,
+                                    RTT_DOWN_BUFFER_SIZE, 0, 0, 0};
+
+  // The magic is written last so a scanning host never sees a
+  // half-initialized block. The source string stays in flash, a copy in
+  // .data would put a second, bogus match into RAM.
+  __DMB();
+  for (int i = sizeof(magic) - 2; i >= 0; i--) {
+    cb->id[i] = magic[i];
+  }
+  __DMB();
+}
+
+/**
+ * Interrupts must be masked
+ */
+static void rtt_ensure_init(void) {
+  if (rtt_control_block.id[0] != 'S') {
+    rtt_init();
+  }
+}
+
+int rtt_write(const char *data, int len) {
+  struct rtt_buffer *ring = &rtt_control_block.up[0];
+  int written = 0;
+
+  // Several contexts may log at once, the write offset is only published
+  // after the data is in place. The first one initializes the block, an
+  // interrupt must not find it half done or have its data reset.
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  rtt_ensure_init();
+
+  uint32_t wr = ring->wrOff;
+  uint32_t rd = ring->rdOff;
+  uint32_t free = rd > wr ? rd - wr - 1 : ring->size - (wr - rd) - 1;
+
+  while (written < len && free > 0) {
+    // Copy up to the end of the buffer, then wrap
+    uint32_t chunk = ring->size - wr;
+    if (chunk > free) {
+      chunk = free;
+    }
+    if (chunk > (uint32_t)(len - written)) {
+      chunk = len - written;
+    }
+    for (uint32_t i = 0; i < chunk; i++) {
+      ring->buffer[wr + i] = data[written + i];
+    }
+    written += chunk;
+    free -= chunk;
+    wr += chunk;
+    if (wr == ring->size) {
+      wr = 0;
+    }
+  }
+
+  __DMB();
+  ring->wrOff = wr;
+  __set_PRIMASK(primask);
+
+  return written;
+}
+
+int rtt_read(char *data, int len) {
+  struct rtt_buffer *ring = &rtt_control_block.down[0];
+  int read = 0;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  rtt_ensure_init();
+
+  uint32_t rd = ring->rdOff;
+  uint32_t wr = ring->wrOff;
+  __DMB();
+
+  while (read < len && rd != wr) {
+    data[read++] = ring->buffer[rd++];
+    if (rd == ring->size) {
+      rd = 0;
+    }
+  }
+
+  ring->rdOff = rd;
+  __set_PRIMASK(primask);
+
+  return read;
+}
@@ -0,0 +1,74 @@
+#ifndef RTT_H
+#define RTT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * In-RAM console that a debugger reads and writes through plain memory
+ * accesses, no UART or SWO pin involved.
+ *
+ * The control block follows the SEGGER RTT layout, so it is located by
+ * scanning RAM for the "SEGGER RTT" magic string, either by
+ * tools/rtt_console.py or by any RTT-aware debugger (OpenOCD, probe-rs).
+ */
+
+#if !defined(RTT_UP_BUFFER_SIZE)
+// A halting reader moves at most one buffer per poll
+#define RTT_UP_BUFFER_SIZE 4096 /* target -> host */
+#endif
+
+#if !defined(RTT_DOWN_BUFFER_SIZE)
+#define RTT_DOWN_BUFFER_SIZE 16 /* host -> target */
+#endif
+
+/**
+ * One ring buffer, written by one side and read by the other.
+ * wrOff is only written by the producer, rdOff only by the consumer.
+ */
+struct rtt_buffer {
+  const char *name;
+  char *buffer;
+  uint32_t size;
+  volatile uint32_t wrOff;
+  volatile uint32_t rdOff;
+  uint32_t flags;
+};
+
+struct rtt_control_block {
+  volatile char id[16];
+  int32_t maxUpBuffers;
+  int32_t maxDownBuffers;
+  struct rtt_buffer up[1];
+  struct rtt_buffer down[1];
+};
+
+extern struct rtt_control_block rtt_control_block;
+
+/**
+ * Publishes the control block, done lazily by the first read or write
+ */
+void rtt_init(void);
+
+/**
+ * Copies as much of data as fits into the up buffer, never blocks
+ *
+ * @return Number of bytes accepted
+ */
+int rtt_write(const char *data, int len);
+
+/**
+ * Copies up to len pending bytes from the down buffer, never blocks
+ *
+ * @return Number of bytes read
+ */
+int rtt_read(char *data, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
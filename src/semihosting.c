@@ -0,0 +1,299 @@
+#include "semihosting.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Buffered host file I/O over semihosting, see semihosting.h
+ */
+
+enum block_state {
+  BLOCK_EMPTY,
+  // block holds data read ahead from the host, host position is past it
+  BLOCK_READ,
+  // block holds data not yet written to the host
+  BLOCK_WRITE,
+};
+
+struct host_file {
+  bool open;
+  uint32_t handle;
+  // logical file position seen by the application
+  uint32_t pos;
+  enum block_state state;
+  uint32_t fill;
+  uint32_t index;
+  char block[SEMIHOSTING_BLOCK_SIZE];
+};
+
+static struct host_file files[SEMIHOSTING_MAX_FILES];
+
+static int host_error(void) {
+  errno = semihosting_call(SEMIHOSTING_SYS_ERRNO, NULL);
+  return -1;
+}
+
+static struct host_file *lookup(int fd) {
+  int idx = fd - SEMIHOSTING_FD_BASE;
+  if (idx < 0 || idx >= SEMIHOSTING_MAX_FILES || !files[idx].open) {
+    errno = EBADF;
+    return NULL;
+  }
+  return &files[idx];
+}
+
+/**
+ * @return Number of bytes transferred
+ */
+static uint32_t host_read(struct host_file *file, char *ptr, uint32_t len) {
+  uint32_t args[3] = {file->handle, (uint32_t)(uintptr_t)ptr, len};
+  // The host returns the number of bytes it could NOT read
+  return len - semihosting_call(SEMIHOSTING_SYS_READ, args);
+}
+
+static int host_write(struct host_file *file, const char *ptr, uint32_t len) {
+  uint32_t args[3] = {file->handle, (uint32_t)(uintptr_t)ptr, len};
+  if (semihosting_call(SEMIHOSTING_SYS_WRITE, args) != 0) {
+    return host_error();
+  }
+  return 0;
+}
+
+static int host_seek(struct host_file *file, uint32_t pos) {
+  uint32_t args[2] = {file->handle, pos};
+  if (semihosting_call(SEMIHOSTING_SYS_SEEK, args) != 0) {
+    return host_error();
+  }
+  return 0;
+}
+
+/**
+ * Brings the host file position back in line with the logical one:
+ * pending writes are sent, read-ahead data is dropped
+ */
+static int sync(struct host_file *file) {
+  int result = 0;
+  if (file->state == BLOCK_WRITE && file->fill > 0) {
+    result = host_write(file, file->block, file->fill);
+  } else if (file->state == BLOCK_READ && file->index != file->fill) {
+    result = host_seek(file, file->pos);
+  }
+  file->state = BLOCK_EMPTY;
+  file->fill = 0;
+  file->index = 0;
+  return result;
+}
+
+int semihosting_file_open(const char *path, int flags) {
+  struct host_file *file = NULL;
+  for (int i = 0; i < SEMIHOSTING_MAX_FILES; i++) {
+    if (!files[i].open) {
+      file = &files[i];
+      break;
+    }
+  }
+  if (file == NULL) {
+    errno = EMFILE;
+    return -1;
+  }
+
+  // Map open() flags onto the fopen() mode index the host expects:
+  // 1 "rb", 3 "r+b", 5 "wb", 7 "w+b", 9 "ab", 11 "a+b"
+  uint32_t mode;
+  int access = flags & O_ACCMODE;
+  if (flags & O_APPEND) {
+    mode = access == O_RDWR ? 11 : 9;
+  } else if (flags & O_TRUNC) {
+    mode = access == O_RDWR ? 7 : 5;
+  } else if (access == O_WRONLY) {
+    mode = 5;
+  } else {
+    mode = access == O_RDWR ? 3 : 1;
+  }
+
+  uint32_t args[3] = {(uint32_t)(uintptr_t)path, mode, strlen(path)};
+  int handle = semihosting_call(SEMIHOSTING_SYS_OPEN, args);
+  if (handle == -1) {
+    return host_error();
+  }
+
+  file->open = true;
+  file->handle = handle;
+  file->pos = 0;
+  file->state = BLOCK_EMPTY;
+  file->fill = 0;
+  file->index = 0;
+  return SEMIHOSTING_FD_BASE + (file - files);
+}
+
+int semihosting_file_close(int fd) {
+  struct host_file *file = lookup(fd);
+  if (file == NULL) {
+    return -1;
+  }
+  int result = sync(file);
+  file->open = false;
+  if (semihosting_call(SEMIHOSTING_SYS_CLOSE, &file->handle) != 0) {
+    return host_error();
+  }
+  return result;
+}
+
+int semihosting_file_read(int fd, char *ptr, int len) {
+  struct host_file *file = lookup(fd);
+  if (file == NULL) {
+    return -1;
+  }
+  if (file->state == BLOCK_WRITE && sync(file) != 0) {
+    return -1;
+  }
+
+  int total = 0;
+  while (len > 0) {
+    if (file->state == BLOCK_READ && file->index < file->fill) {
+      uint32_t chunk = file->fill - file->index;
+      if (chunk > (uint32_t)len) {
+        chunk = len;
+      }
+      memcpy(ptr, &file->block[file->index], chunk);
+      file->index += chunk;
+      file->pos += chunk;
+      ptr += chunk;
+      total += chunk;
+      len -= chunk;
+      continue;
+    }
+
+    file->state = BLOCK_EMPTY;
+    if (len >= SEMIHOSTING_BLOCK_SIZE) {
+      // Large requests go straight into the caller's buffer
+      uint32_t got = host_read(file, ptr, len);
+      file->pos += got;
+      total += got;
+      break;
+    }
+
+    uint32_t got = host_read(file, file->block, SEMIHOSTING_BLOCK_SIZE);
+    if (got == 0) {
+      break; // end of file
+    }
+    file->state = BLOCK_READ;
+    file->fill = got;
+    file->index = 0;
+  }
+  return total;
+}
+
+int semihosting_file_write(int fd, const char *ptr, int len) {
+  struct host_file *file = lookup(fd);
+  if (file == NULL) {
+    return -1;
+  }
+  if (file->state == BLOCK_READ && sync(file) != 0) {
+    return -1;
+  }
+
+  if (file->fill + len > SEMIHOSTING_BLOCK_SIZE) {
+    if (sync(file) != 0) {
+      return -1;
+    }
+    if (len >= SEMIHOSTING_BLOCK_SIZE) {
+      if (host_write(file, ptr, len) != 0) {
+        return -1;
+      }
+      file->pos += len;
+      return len;
+    }
+  }
+
+  memcpy(&file->block[file->fill], ptr, len);
+  file->state = BLOCK_WRITE;
+  file->fill += len;
+  file->pos += len;
+  if (file->fill == SEMIHOSTING_BLOCK_SIZE && sync(file) != 0) {
+    return -1;
+  }
+  return len;
+}
+
+int semihosting_file_seek(int fd, int offset, int whence) {
+  struct host_file *file = lookup(fd);
+  if (file == NULL || sync(file) != 0) {
+    return -1;
+  }
+
+  int base = 0;
+  if (whence == SEEK_CUR) {
+    base = file->pos;
+  } else if (whence == SEEK_END) {
+    base = semihosting_call(SEMIHOSTING_SYS_FLEN, &file->handle);
+    if (base < 0) {
+      return host_error();
+    }
+  }
+  if (base + offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (host_seek(file, base + offset) != 0) {
+    return -1;
+  }
+  file->pos = base + offset;
+  return file->pos;
+}
+
+int semihosting_file_size(int fd) {
+  struct host_file *file = lookup(fd);
+  if (file == NULL) {
+    return -1;
+  }
+  // Pending data counts towards the size the application expects
+  if (file->state == BLOCK_WRITE && sync(file) != 0) {
+    return -1;
+  }
+  int size = semihosting_call(SEMIHOSTING_SYS_FLEN, &file->handle);
+  return size < 0 ? host_error() : size;
+}
+
+/**
+ * Opens the host terminal ":tt" in the given fopen() mode index
+ */
+static int console_handle(int *handle, uint32_t mode) {
+  if (*handle == -1) {
+    static const char tt[] = ":tt";
+    uint32_t args[3] = {(uint32_t)(uintptr_t)tt, mode, sizeof(tt) - 1};
+    *handle = semihosting_call(SEMIHOSTING_SYS_OPEN, args);
+  }
+  return *handle;
+}
+
+int semihosting_console_read(char *ptr, int len) {
+  static int handle = -1;
+  uint32_t args[3] = {console_handle(&handle, 0), (uint32_t)(uintptr_t)ptr,
+                      len};
+  if (args[0] == (uint32_t)-1) {
+    return host_error();
+  }
+  return len - semihosting_call(SEMIHOSTING_SYS_READ, args);
+}
+
+int semihosting_console_write(const char *ptr, int len) {
+  static int handle = -1;
+  uint32_t args[3] = {console_handle(&handle, 4), (uint32_t)(uintptr_t)ptr,
+                      len};
+  if (args[0] == (uint32_t)-1) {
+    return host_error();
+  }
+  return len - semihosting_call(SEMIHOSTING_SYS_WRITE, args);
+}
+
+void semihosting_exit(int status) {
+  uint32_t args[2] = {SEMIHOSTING_ADP_STOPPED_APPLICATION_EXIT, status};
+  semihosting_call(SEMIHOSTING_SYS_EXIT_EXTENDED, args);
+  // Only reached without a host attached
+  while (1) {
+  }
+}
@@ -0,0 +1,78 @@
+#ifndef SEMIHOSTING_H
+#define SEMIHOSTING_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * ARM semihosting: the firmware traps into the debugger (or QEMU with
+ * -semihosting) with BKPT 0xAB and the host performs the request.
+ *
+ * Each trap halts the core for a round trip to the host, so file data is
+ * staged in SEMIHOSTING_BLOCK_SIZE blocks and moved with one trap per block.
+ */
+
+#if !defined(SEMIHOSTING_BLOCK_SIZE)
+#define SEMIHOSTING_BLOCK_SIZE 512
+#endif
+
+#if !defined(SEMIHOSTING_MAX_FILES)
+#define SEMIHOSTING_MAX_FILES 4
+#endif
+
+// File descriptors below this one are the console (stdin/stdout/stderr)
+#define SEMIHOSTING_FD_BASE 3
+
+// Operation numbers from the ARM semihosting specification
+#define SEMIHOSTING_SYS_OPEN 0x01
+#define SEMIHOSTING_SYS_CLOSE 0x02
+#define SEMIHOSTING_SYS_WRITE 0x05
+#define SEMIHOSTING_SYS_READ 0x06
+#define SEMIHOSTING_SYS_SEEK 0x0A
+#define SEMIHOSTING_SYS_FLEN 0x0C
+#define SEMIHOSTING_SYS_ERRNO 0x13
+#define SEMIHOSTING_SYS_EXIT_EXTENDED 0x20
+
+// Exit reason for a regular program end
+#define SEMIHOSTING_ADP_STOPPED_APPLICATION_EXIT 0x20026
+
+/**
+ * Raw semihosting trap
+ */
+static inline int semihosting_call(int op, const void *arg) {
+  register int r0 __asm__("r0") = op;
+  register const void *r1 __asm__("r1") = arg;
+  __asm__ volatile("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+  return r0;
+}
+
+/**
+ * Buffered host files, arguments and results follow open(2)/read(2)/...
+ */
+int semihosting_file_open(const char *path, int flags);
+int semihosting_file_close(int fd);
+int semihosting_file_read(int fd, char *ptr, int len);
+int semihosting_file_write(int fd, const char *ptr, int len);
+int semihosting_file_seek(int fd, int offset, int whence);
+int semihosting_file_size(int fd);
+
+/**
+ * Console on the host's terminal, used for stdin/stdout/stderr unless the
+ * RTT console is enabled
+ */
+int semihosting_console_read(char *ptr, int len);
+int semihosting_console_write(const char *ptr, int len);
+
+/**
+ * Ends the debug session (or QEMU) with `status` as the exit code
+ */
+void semihosting_exit(int status) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -29,6 +29,13 @@
 #include <time.h>
 #include <sys/time.h>
 #include <sys/times.h>
+#include "timebase.h"
+#if defined(CONSOLE_RTT)
+#include "rtt.h"
+#endif
+#if defined(SEMIHOSTING)
+#include "semihosting.h"
+#endif
 
 
 /* Variables */
@@ -60,13 +67,33 @@ int _kill(int pid, int sig)
 
 void _exit (int status)
 {
+#if defined(SEMIHOSTING)
+  /* Hands the status to the debugger or QEMU as the exit code */
+  semihosting_exit(status);
+#endif
   _kill(status, -1);
   while (1) {}    /* Make sure we hang here */
 }
 
 __attribute__((weak)) int _read(int file, char *ptr, int len)
 {
+#if defined(SEMIHOSTING)
+  if (file >= SEMIHOSTING_FD_BASE)
+  {
+    return semihosting_file_read(file, ptr, len);
+  }
+#endif
   (void)file;
+#if defined(CONSOLE_RTT)
+  int count;
+
+  /* Wait for the host to send something, then take what is pending */
+  while ((count = rtt_read(ptr, len)) == 0) {}
+
+  return count;
+#elif defined(SEMIHOSTING)
+  return semihosting_console_read(ptr, len);
+#else
   int DataIdx;
 
   for (DataIdx = 0; DataIdx < len; DataIdx++)
@@ -75,11 +102,25 @@ __attribute__((weak)) int _read(int file, char *ptr, int len)
   }
 
   return len;
+#endif
 }
 
 __attribute__((weak)) int _write(int file, char *ptr, int len)
 {
+#if defined(SEMIHOSTING)
+  if (file >= SEMIHOSTING_FD_BASE)
+  {
+    return semihosting_file_write(file, ptr, len);
+  }
+#endif
   (void)file;
+#if defined(CONSOLE_RTT)
+  /* Output that does not fit is dropped rather than stalling the caller */
+  rtt_write(ptr, len);
+  return len;
+#elif defined(SEMIHOSTING)
+  return semihosting_console_write(ptr, len);
+#else
   int DataIdx;
 
   for (DataIdx = 0; DataIdx < len; DataIdx++)
@@ -87,10 +128,17 @@ __attribute__((weak)) int _write(int file, char *ptr, int len)
     __io_putchar(*ptr++);
   }
   return len;
+#endif
 }
 
 int _close(int file)
 {
+#if defined(SEMIHOSTING)
+  if (file >= SEMIHOSTING_FD_BASE)
+  {
+    return semihosting_file_close(file);
+  }
+#endif
   (void)file;
   return -1;
 }
@@ -98,6 +146,20 @@ int _close(int file)
 
 int _fstat(int file, struct stat *st)
 {
+#if defined(SEMIHOSTING)
+  if (file >= SEMIHOSTING_FD_BASE)
+  {
+    int size = semihosting_file_size(file);
+    if (size < 0)
+    {
+      return -1;
+    }
+    st->st_mode = S_IFREG;
+    st->st_size = size;
+    st->st_blksize = SEMIHOSTING_BLOCK_SIZE;
+    return 0;
+  }
+#endif
   (void)file;
   st->st_mode = S_IFCHR;
   return 0;
@@ -105,12 +167,22 @@ int _fstat(int file, struct stat *st)
 
 int _isatty(int file)
 {
+#if defined(SEMIHOSTING)
+  return file < SEMIHOSTING_FD_BASE;
+#else
   (void)file;
   return 1;
+#endif
 }
 
 int _lseek(int file, int ptr, int dir)
 {
+#if defined(SEMIHOSTING)
+  if (file >= SEMIHOSTING_FD_BASE)
+  {
+    return semihosting_file_seek(file, ptr, dir);
+  }
+#endif
   (void)file;
   (void)ptr;
   (void)dir;
@@ -119,10 +191,14 @@ int _lseek(int file, int ptr, int dir)
 
 int _open(char *path, int flags, ...)
 {
+#if defined(SEMIHOSTING)
+  return semihosting_file_open(path, flags);
+#else
   (void)path;
   (void)flags;
   /* Pretend like we always fail */
   return -1;
+#endif
 }
 
 int _wait(int *status)
@@ -141,8 +217,28 @@ int _unlink(char *name)
 
 int _times(struct tms *buf)
 {
-  (void)buf;
-  return -1;
+  /* Everything runs on one core without processes, so all elapsed time
+     counts as user time of this one, in CLOCKS_PER_SEC units */
+  uint64_t ns = timebase_ns();
+  clock_t clocks = (ns / 1000000000U) * CLOCKS_PER_SEC +
+                   (ns % 1000000000U) * CLOCKS_PER_SEC / 1000000000U;
+
+  buf->tms_utime = clocks;
+  buf->tms_stime = 0;
+  buf->tms_cutime = 0;
+  buf->tms_cstime = 0;
+  return clocks;
+}
+
+int _gettimeofday(struct timeval *tv, void *tz)
+{
+  (void)tz;
+  /* There is no calendar clock, time is counted from boot */
+  uint64_t ns = timebase_ns();
+
+  tv->tv_sec = ns / 1000000000U;
+  tv->tv_usec = (ns % 1000000000U) / 1000U;
+  return 0;
 }
 
 int _stat(char *file, struct stat *st)
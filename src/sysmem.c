@@ -22,6 +22,7 @@
 
 /* Includes */
 #include <errno.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
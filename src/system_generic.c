@@ -0,0 +1,21 @@
+#include "device.h"
+
+/**
+ * System initialization of the bare-core variants. The board supplies a
+ * fixed clock (25 MHz on the MPS2 images), so only the FPU needs enabling.
+ */
+
+#if !defined(SYSTEM_CORE_CLOCK_HZ)
+#define SYSTEM_CORE_CLOCK_HZ 25000000U
+#endif
+
+uint32_t SystemCoreClock = SYSTEM_CORE_CLOCK_HZ;
+
+void SystemInit(void) {
+#if (__FPU_PRESENT == 1) && (__FPU_USED == 1)
+  // Full access to CP10 and CP11
+  SCB->CPACR |= (3UL << 10 * 2) | (3UL << 11 * 2);
+#endif
+}
+
+void SystemCoreClockUpdate(void) {}
@@ -46,6 +46,9 @@
 
 
 #include "stm32f4xx.h"
+#if defined(CLOCK_SYSCLK_HZ)
+#include "clock.h"
+#endif
 
 #if !defined  (HSE_VALUE) 
   #define HSE_VALUE    ((uint32_t)25000000) /*!< Default value of the External oscillator in Hz */
@@ -134,7 +137,11 @@
                is no need to call the 2 first functions listed above, since SystemCoreClock
                variable is updated automatically.
   */
+#if defined(CLOCK_SYSCLK_HZ)
+uint32_t SystemCoreClock = CLOCK_SYSCLK_HZ;
+#else
 uint32_t SystemCoreClock = 16000000;
+#endif
 const uint8_t AHBPrescTable[16] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9};
 const uint8_t APBPrescTable[8]  = {0, 0, 0, 0, 1, 2, 3, 4};
 /**
@@ -175,6 +182,15 @@ void SystemInit(void)
   SystemInit_ExtMemCtl(); 
 #endif /* DATA_IN_ExtSRAM || DATA_IN_ExtSDRAM */
 
+  /* Switch to the SYSCLK selected at build time -----------------------------*/
+#if defined(CLOCK_SYSCLK_HZ)
+  if (clock_boot() != 0)
+  {
+    /* The PLL did not lock, hang like CubeMX's Error_Handler() */
+    while (1) {}
+  }
+#endif /* CLOCK_SYSCLK_HZ */
+
   /* Configure the Vector Table location -------------------------------------*/
 #if defined(USER_VECT_TAB_ADDRESS)
   SCB->VTOR = VECT_TAB_BASE_ADDRESS | VECT_TAB_OFFSET; /* Vector Table Relocation in Internal SRAM */
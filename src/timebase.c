@@ -0,0 +1,147 @@
+#include "timebase.h"
+#include "device.h"
+#include <stdbool.h>
+
+/**
+ * DWT + SysTick time base, see timebase.h
+ */
+
+// Upper half of the 64-bit cycle count and the last lower half observed
+static uint32_t cyclesHigh;
+static uint32_t cyclesLastLow;
+
+// Cycle count and time at the last clock change, ns are derived from them
+static uint64_t baseCycles;
+static uint64_t baseNs;
+static uint32_t baseHz;
+
+// Cycles that passed while the counter was stopped in sleep
+static uint64_t cyclesSkipped;
+
+// Without a cycle counter (QEMU) SysTick counts the cycles: the cycle count
+// at the start of the current SysTick period and the period's length
+static bool sysTickCycles;
+static uint64_t periodStart;
+static uint32_t periodCycles;
+
+static volatile uint32_t ticks;
+
+/**
+ * Cycle count from SysTick, interrupts must be masked
+ */
+static uint64_t systick_cycles_locked(void) {
+  uint64_t start = periodStart;
+  uint32_t length = periodCycles;
+  uint32_t val = SysTick->VAL;
+  if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+    // Reloaded, but the handler has not accounted for it yet
+    start += length;
+    length = SysTick->LOAD + 1;
+    val = SysTick->VAL;
+  }
+  return start + length - 1 - val;
+}
+
+/**
+ * Extends CYCCNT to 64 bits, interrupts must be masked. Every read notes
+ * the low half, so a smaller value than last time means one wrap.
+ */
+static uint64_t cycles_locked(void) {
+  if (sysTickCycles) {
+    return systick_cycles_locked();
+  }
+
+  uint32_t low = DWT->CYCCNT;
+  if (low < cyclesLastLow) {
+    cyclesHigh++;
+  }
+  cyclesLastLow = low;
+  return (((uint64_t)cyclesHigh << 32) | low) + cyclesSkipped;
+}
+
+static uint64_t cycles_to_ns(uint64_t cycles, uint32_t hz) {
+  // Split to keep cycles * 1e9 from overflowing after ~100 s
+  return cycles / hz * 1000000000ULL + cycles % hz * 1000000000ULL / hz;
+}
+
+void timebase_init(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  // The enable bit does not stick where there is no counter
+  sysTickCycles = !(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk);
+
+  cyclesHigh = 0;
+  cyclesLastLow = 0;
+  baseCycles = 0;
+  baseNs = 0;
+  baseHz = SystemCoreClock;
+  cyclesSkipped = 0;
+  ticks = 0;
+
+  SysTick_Config(SystemCoreClock / TIMEBASE_TICK_HZ);
+  periodStart = 0;
+  periodCycles = SysTick->LOAD + 1;
+}
+
+void timebase_clock_update(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  uint64_t cycles = cycles_locked();
+  baseNs += cycles_to_ns(cycles - baseCycles, baseHz);
+  baseCycles = cycles;
+  baseHz = SystemCoreClock;
+
+  SysTick->LOAD = SystemCoreClock / TIMEBASE_TICK_HZ - 1;
+  if (!sysTickCycles) {
+    SysTick->VAL = 0;
+  }
+  // Otherwise the running period ends at its old length, see the handler
+
+  __set_PRIMASK(primask);
+}
+
+uint64_t timebase_cycles(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint64_t cycles = cycles_locked();
+  __set_PRIMASK(primask);
+  return cycles;
+}
+
+uint64_t timebase_ns(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint64_t cycles = cycles_locked() - baseCycles;
+  uint64_t ns = baseNs;
+  uint32_t hz = baseHz;
+  __set_PRIMASK(primask);
+
+  return ns + cycles_to_ns(cycles, hz);
+}
+
+uint32_t timebase_ticks(void) { return ticks; }
+
+bool timebase_has_cycle_counter(void) { return !sysTickCycles; }
+
+void timebase_resync(uint32_t elapsed, uint32_t counted,
+                     uint32_t elapsedTicks) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (elapsed > counted) {
+    cyclesSkipped += elapsed - counted;
+  }
+  ticks += elapsedTicks;
+  __set_PRIMASK(primask);
+}
+
+void SysTick_Handler(void) {
+  if (sysTickCycles) {
+    periodStart += periodCycles;
+    periodCycles = SysTick->LOAD + 1;
+  }
+  ticks++;
+  // Keeps the wrap detection fed even if nobody reads the time
+  timebase_cycles();
+}
@@ -0,0 +1,72 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 64-bit monotonic time base.
+ *
+ * The DWT cycle counter gives single-cycle resolution, SysTick fires every
+ * 1/TIMEBASE_TICK_HZ seconds and catches the 32-bit counter wrapping long
+ * before it can wrap twice (~23 s at 180 MHz). All readers are safe to call
+ * from interrupt handlers.
+ *
+ * Where the cycle counter is missing (QEMU does not model the DWT), cycles
+ * are counted by SysTick instead, at the resolution the emulator gives it.
+ */
+
+#if !defined(TIMEBASE_TICK_HZ)
+#define TIMEBASE_TICK_HZ 1000
+#endif
+
+/**
+ * Starts the cycle counter and SysTick at the current SystemCoreClock
+ */
+void timebase_init(void);
+
+/**
+ * Must be called after SystemCoreClock changes, keeps the nanosecond time
+ * continuous across the switch and reprograms SysTick
+ */
+void timebase_clock_update(void);
+
+/**
+ * Core clock cycles since timebase_init()
+ */
+uint64_t timebase_cycles(void);
+
+/**
+ * Nanoseconds since timebase_init()
+ */
+uint64_t timebase_ns(void);
+
+/**
+ * Periods of 1/TIMEBASE_TICK_HZ since timebase_init()
+ */
+uint32_t timebase_ticks(void);
+
+/**
+ * @return false if SysTick counts the cycles and so has to keep running
+ */
+bool timebase_has_cycle_counter(void);
+
+/**
+ * Accounts for a period with SysTick suppressed: `elapsed` cycles passed
+ * according to SysTick, `counted` of them were seen by the cycle counter
+ * (which may stop while the core sleeps), and `elapsedTicks` tick periods
+ * completed that the handler did not count. Call with SysTick back at its
+ * regular period.
+ */
+void timebase_resync(uint32_t elapsed, uint32_t counted,
+                     uint32_t elapsedTicks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""
+Flash cost of src/format.c against newlib-nano's printf family.
+
+Reads the linker map of a BENCHMARK build, which links both: the input
+sections of format.c on one side, on the other every libc archive member
+the linker pulled in for a *printf reference and, transitively, for the
+members pulled in by those. Members something else had already pulled in
+are not counted against printf.
+
+    tools/format_size.py stm32-boot-explained.map
+"""
+
+import argparse
+import os
+import re
+import sys
+
+# Output sections that occupy flash (.data and .ram_code by their load copy)
+FLASH = (".isr_vector", ".ram_code", ".text", ".rodata", ".data")
+INPUT_LINE = re.compile(r"^ (\.\S+)(?:\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S.*))?$")
+ADDRESS_LINE = re.compile(r"^\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S.*)$")
+# file (symbol)
+REASON = re.compile(r"^(\S.*) \((\S+)\)$")
+PRINTF = re.compile(r"printf")
+
+
+def archive_members(lines):
+    """
+    @return {member: (referencing file, symbol)} from the map's
+            "Archive member included to satisfy reference" list
+    """
+    members = {}
+    member = None
+    for line in lines:
+        if line.startswith(("Allocating", "Discarded", "Memory")):
+            break
+        if not line.strip():
+            continue
+        if not line.startswith(" "):
+            # The member, followed by the reason when both fit one line
+            member, _, line = line.partition(" ")
+        match = REASON.match(line.strip())
+        if match and member:
+            members[member] = (match.group(1), match.group(2))
+            member = None
+    return members
+
+
+def printf_members(members):
+    # Referenced by the application, then by anything already counted
+    chosen = {member for member, (origin, symbol) in members.items()
+              if ".a(" not in origin and PRINTF.search(symbol)}
+    grown = True
+    while grown:
+        grown = False
+        for member, (origin, _) in members.items():
+            if member not in chosen and origin in chosen:
+                chosen.add(member)
+                grown = True
+    return chosen
+
+
+def input_sizes(lines):
+    """
+    @return {origin: bytes} of the input sections in flash output sections
+    """
+    sizes = {}
+    output = None
+    pending = False
+    for line in lines:
+        if line.startswith("."):
+            output = line.split()[0]
+            continue
+        if pending:
+            pending = False
+            match = ADDRESS_LINE.match(line)
+            if match:
+                add(sizes, output, match.group(2), match.group(3))
+            continue
+        match = INPUT_LINE.match(line)
+        if match:
+            if match.group(2) is None:
+                pending = True
+            else:
+                add(sizes, output, match.group(3), match.group(4))
+    return sizes
+
+
+def add(sizes, output, size, origin):
+    if output in FLASH:
+        origin = origin.strip()
+        sizes[origin] = sizes.get(origin, 0) + int(size, 16)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("map", help="linker map of a BENCHMARK build")
+    parser.add_argument("--source", default="format.c",
+                        help="object file name of the formatter")
+    args = parser.parse_args()
+
+    with open(args.map) as map_file:
+        lines = map_file.read().splitlines()
+    start = next((i for i, line in enumerate(lines)
+                  if line.startswith("Archive member included")), len(lines))
+    members = archive_members(lines[start + 1:])
+    sizes = input_sizes(lines)
+
+    formatter = sum(size for origin, size in sizes.items()
+                    if re.search(r"(^|/)%s\.(obj|o)$" % re.escape(args.source), origin))
+    newlib = sorted(((sizes.get(member, 0), member) for member in printf_members(members)),
+                    reverse=True)
+    if not formatter or not newlib:
+        print("%s does not link both %s and a libc printf, build with BENCHMARK"
+              % (args.map, args.source), file=sys.stderr)
+        return 1
+
+    print("%7d bytes  %s" % (formatter, args.source))
+    print("%7d bytes  newlib-nano printf" % sum(size for size, _ in newlib))
+    for size, member in newlib:
+        print("    %7d  %s" % (size, os.path.basename(member)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""
+Profile-guided placement of hot functions into SRAM.
+
+Program counter samples are attributed to the functions of the ELF and
+ranked. The hottest functions that fit into _Ram_Code_Budget (from the
+linker script) are written to hot_functions.ld, which the .ram_code
+section of the linker script includes and Reset_Handler copies to RAM.
+
+Samples come from either
+  --qemu-trace  a QEMU log of `-d exec,nochain -D trace.log`, one sample per
+                executed translation block
+  --swo         a raw SWO capture of DWT PC sampling, see src/pcsample.h
+  --pc-list     one hexadecimal address per line, from any other source
+
+    tools/hot_placement.py app.elf --qemu-trace trace.log \\
+        --linker-script src/STM32F446RETx_FLASH.ld --output src/hot_functions.ld
+
+With --build-dir the firmware is rebuilt after writing the fragment, and the
+coldest placed function is dropped again as long as the linked .ram_code
+(alignment and veneers included) does not fit the budget.
+"""
+
+import argparse
+import bisect
+import os
+import re
+import subprocess
+import sys
+
+# Run before or during Reset_Handler's copy loop, which comes ahead of
+# SystemInit() and the boot clock switch, must stay in flash. The compiler
+# may turn the loop itself into a memcpy call.
+STARTUP = {"Reset_Handler", "memcpy"}
+
+# Trace 0: 0x7f.. [cs_base/pc/flags/cflags] or, from older QEMU, [pc]
+QEMU_TRACE = re.compile(r"^Trace .*?\[([0-9a-fA-F]+)(?:/([0-9a-fA-F]+))?")
+
+# ITM hardware source packet ID of DWT periodic PC samples
+ITM_PC_SAMPLE = 2
+
+
+class Symbols:
+    def __init__(self, readelf, elf):
+        functions = []
+        for line in subprocess.check_output([readelf, "-sW", elf], text=True).splitlines():
+            # Num: Value Size Type Bind Vis Ndx Name
+            fields = line.split()
+            if len(fields) < 8 or not fields[0].endswith(":") or fields[3] != "FUNC":
+                continue
+            size = int(fields[2], 0)
+            if size:
+                # Thumb functions have bit 0 set
+                functions.append((int(fields[1], 16) & ~1, size, fields[7]))
+        functions.sort()
+        self.starts = [start for start, _, _ in functions]
+        self.functions = functions
+
+    def lookup(self, pc):
+        index = bisect.bisect_right(self.starts, pc) - 1
+        if index >= 0:
+            start, size, name = self.functions[index]
+            if pc < start + size:
+                return name
+        return None
+
+    def size(self, name):
+        return max((size for _, size, known in self.functions if known == name), default=0)
+
+
+def qemu_samples(path):
+    with open(path, errors="replace") as trace:
+        for line in trace:
+            match = QEMU_TRACE.match(line)
+            if match:
+                yield int(match.group(2) or match.group(1), 16)
+
+
+def swo_samples(path):
+    """
+    Walks the ITM/DWT packet stream and yields the PC sample payloads
+    """
+    with open(path, "rb") as capture:
+        data = capture.read()
+    i = 0
+    while i < len(data):
+        header = data[i]
+        i += 1
+        if header in (0x00, 0x80, 0x70) or header & 0x0F == 0x04:
+            # Synchronization (zeros up to 0x80), overflow, reserved
+            continue
+        if header & 0x0F == 0x00 or header & 0x0B == 0x08 or header & 0xDF == 0x94:
+            # Timestamps and extensions, continued while bit 7 is set
+            if header & 0x80:
+                while i < len(data) and data[i] & 0x80:
+                    i += 1
+                i += 1
+            continue
+        size = {1: 1, 2: 2, 3: 4}[header & 0x03]
+        payload = data[i:i + size]
+        i += size
+        # Hardware source with a 4-byte payload; 1 byte means the core slept
+        if header & 0x04 and header >> 3 == ITM_PC_SAMPLE and size == 4:
+            yield int.from_bytes(payload, "little")
+
+
+def list_samples(path):
+    with open(path) as pcs:
+        for line in pcs:
+            line = line.strip()
+            if line and not line.startswith("#"):
+                yield int(line, 16)
+
+
+def rank(symbols, samples):
+    counts = {}
+    total = 0
+    for pc in samples:
+        total += 1
+        name = symbols.lookup(pc)
+        if name is not None:
+            counts[name] = counts.get(name, 0) + 1
+    return sorted(counts.items(), key=lambda c: -c[1]), total
+
+
+def choose(symbols, ranking, total, budget, min_share, top):
+    chosen, used = [], 0
+    for name, count in ranking:
+        if name in STARTUP or count < total * min_share / 100:
+            continue
+        size = (symbols.size(name) + 3) & ~3
+        if used + size <= budget:
+            chosen.append((name, count, size))
+            used += size
+        if top and len(chosen) == top:
+            break
+    return chosen
+
+
+def write_fragment(path, chosen, total, source):
+    with open(path, "w") as fragment:
+        fragment.write("/* Functions placed into .ram_code, regenerate with "
+                       "tools/hot_placement.py */\n")
+        fragment.write("/* %d samples from %s */\n" % (total, os.path.basename(source)))
+        for name, count, size in chosen:
+            # Clones (.constprop, .part, ...) follow the function
+            fragment.write("*(.text.%s .text.%s.*) /* %.1f%%, %d bytes */\n"
+                           % (name, name, 100.0 * count / total, size))
+
+
+def ram_code_size(readelf, elf):
+    for line in subprocess.check_output([readelf, "-SW", elf], text=True).splitlines():
+        # [Nr] Name Type Address Off Size ...
+        fields = line.replace("[ ", "[").split()
+        if len(fields) > 5 and fields[1] == ".ram_code":
+            return int(fields[5], 16)
+    return 0
+
+
+def linker_budget(linker_script):
+    with open(linker_script) as script:
+        match = re.search(r"_Ram_Code_Budget\s*=\s*(0x[0-9a-fA-F]+|\d+)", script.read())
+    return int(match.group(1), 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("elf", help="the profiled firmware")
+    profile = parser.add_mutually_exclusive_group(required=True)
+    profile.add_argument("--qemu-trace")
+    profile.add_argument("--swo")
+    profile.add_argument("--pc-list")
+    parser.add_argument("--readelf", default="arm-none-eabi-readelf")
+    parser.add_argument("--linker-script", default="src/STM32F446RETx_FLASH.ld")
+    parser.add_argument("--output", default="src/hot_functions.ld")
+    parser.add_argument("--min-share", type=float, default=1.0,
+                        help="percent of the samples a function needs to move")
+    parser.add_argument("--top", type=int, default=0, help="move at most N functions")
+    parser.add_argument("--build-dir",
+                        help="rebuild there and shrink the list until it links")
+    args = parser.parse_args()
+
+    symbols = Symbols(args.readelf, args.elf)
+    if args.qemu_trace:
+        source, samples = args.qemu_trace, qemu_samples(args.qemu_trace)
+    elif args.swo:
+        source, samples = args.swo, swo_samples(args.swo)
+    else:
+        source, samples = args.pc_list, list_samples(args.pc_list)
+    ranking, total = rank(symbols, samples)
+    if not total:
+        print("no samples in %s" % source, file=sys.stderr)
+        return 1
+
+    print("samples  share  bytes  function")
+    for name, count in ranking[:20]:
+        print("%7d %5.1f%% %6d  %s" % (count, 100.0 * count / total,
+                                      symbols.size(name), name))
+
+    budget = linker_budget(args.linker_script)
+    chosen = choose(symbols, ranking, total, budget, args.min_share, args.top)
+    while True:
+        write_fragment(args.output, chosen, total, source)
+        if not args.build_dir:
+            break
+        built = subprocess.run(["cmake", "--build", args.build_dir],
+                               stdout=subprocess.DEVNULL).returncode == 0
+        if built and ram_code_size(args.readelf, args.elf) <= budget:
+            break
+        if not chosen:
+            print("build fails without any hot functions", file=sys.stderr)
+            return 1
+        # The link asserts on the budget: give up the coldest one
+        print("over budget, dropping %s" % chosen.pop()[0], file=sys.stderr)
+
+    used = sum(size for _, _, size in chosen)
+    share = sum(count for _, count, _ in chosen)
+    print()
+    print("%d functions, %d of %d bytes, %.1f%% of the samples -> %s"
+          % (len(chosen), used, budget, 100.0 * share / total, args.output))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
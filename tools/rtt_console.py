@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""
+Host side of the in-RAM console (src/rtt.c).
+
+Talks the GDB remote serial protocol directly, so it works against QEMU's
+gdbstub (-s / -gdb tcp::1234) as well as ST-LINK_gdbserver. The control
+block is located by scanning RAM for the "SEGGER RTT" magic, then the up
+buffer is drained to stdout and stdin lines are pushed into the down buffer.
+
+    tools/rtt_console.py --port 1234
+
+Where the server offers non-stop mode, memory is read in the background while
+the core keeps running. Otherwise (QEMU, and --halt) every poll halts the core
+for its reads, which disturbs the firmware's timing and bounds throughput to
+one up buffer (RTT_UP_BUFFER_SIZE) per halt round trip of the server. The rate
+reached is printed on exit.
+"""
+
+import argparse
+import os
+import select
+import socket
+import struct
+import sys
+import time
+
+MAGIC = b"SEGGER RTT"
+# id[16], maxUpBuffers, maxDownBuffers
+HEADER_SIZE = 16 + 4 + 4
+# name, buffer, size, wrOff, rdOff, flags
+BUFFER_DESC = struct.Struct("<IIIIII")
+
+
+class GdbRemote:
+    def __init__(self, host, port):
+        self.sock = socket.create_connection((host, port))
+        self.halt = True
+        self.running = True
+        self.rx = b""
+        # Largest read whose hex reply fits the server's packet buffer
+        self.max_read = 1024
+
+    def _recv_packet(self):
+        while True:
+            start = self.rx.find(b"$")
+            end = self.rx.find(b"#", start)
+            if start >= 0 and end >= 0 and len(self.rx) >= end + 3:
+                payload = self.rx[start + 1:end]
+                self.rx = self.rx[end + 3:]
+                self.sock.sendall(b"+")
+                return self._expand(payload)
+            chunk = self.sock.recv(65536)
+            if not chunk:
+                raise ConnectionError("gdb server closed the connection")
+            self.rx += chunk
+
+    @staticmethod
+    def _expand(payload):
+        # Run-length encoding: "X*n" repeats X (ord(n) - 29) more times
+        out = bytearray()
+        i = 0
+        while i < len(payload):
+            if payload[i:i + 1] == b"*" and out:
+                out += out[-1:] * (payload[i + 1] - 29)
+                i += 2
+            else:
+                out.append(payload[i])
+                i += 1
+        return bytes(out)
+
+    def _send(self, data, reply=True):
+        checksum = sum(data) & 0xFF
+        self.sock.sendall(b"$" + data + b"#%02x" % checksum)
+        return self._recv_packet() if reply else None
+
+    def negotiate(self):
+        for feature in self._send(b"qSupported").split(b";"):
+            if feature.startswith(b"PacketSize="):
+                self.max_read = (int(feature[11:], 16) - 8) // 2
+
+    def background(self):
+        """
+        Switches a halted target to non-stop mode and resumes it, memory is
+        then read while it runs
+
+        @return False if the server only has all-stop mode
+        """
+        if self._send(b"QNonStop:1") != b"OK":
+            return False
+        self._send(b"vCont;c")
+        self.halt = False
+        self.running = True
+        return True
+
+    def stop(self):
+        if self.halt and self.running:
+            self.sock.sendall(b"\x03")
+            self._recv_packet()  # stop reply
+            self.running = False
+
+    def resume(self):
+        if self.halt and not self.running:
+            self._send(b"c", reply=False)
+            self.running = True
+
+    def read(self, addr, size):
+        data = b""
+        while size > 0:
+            chunk = min(size, self.max_read)
+            reply = self._send(b"m%x,%x" % (addr, chunk))
+            if reply.startswith(b"E"):
+                raise IOError("cannot read 0x%08x: %s" % (addr, reply.decode()))
+            data += bytes.fromhex(reply.decode())
+            addr += chunk
+            size -= chunk
+        return data
+
+    def write(self, addr, data):
+        reply = self._send(b"M%x,%x:" % (addr, len(data)) + data.hex().encode())
+        if reply != b"OK":
+            raise IOError("cannot write 0x%08x: %s" % (addr, reply.decode()))
+
+
+def find_control_block(gdb, start, size):
+    step = 4096
+    for addr in range(start, start + size, step):
+        # Overlap chunks so a magic crossing a boundary is still found
+        window = gdb.read(addr, min(step + len(MAGIC), start + size - addr))
+        offset = window.find(MAGIC + b"\0")
+        if offset >= 0:
+            return addr + offset
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=1234)
+    parser.add_argument("--ram-start", type=lambda v: int(v, 0), default=0x20000000)
+    parser.add_argument("--ram-size", type=lambda v: int(v, 0), default=128 * 1024)
+    parser.add_argument("--address", type=lambda v: int(v, 0),
+                        help="control block address, skips the RAM scan")
+    parser.add_argument("--interval", type=float, default=0.01,
+                        help="polling period in seconds while the buffer is empty")
+    parser.add_argument("--halt", action="store_true",
+                        help="halt the core for every poll even if the server "
+                             "could read in the background")
+    args = parser.parse_args()
+
+    gdb = GdbRemote(args.host, args.port)
+    gdb.stop()
+    gdb.negotiate()
+
+    block = args.address
+    while block is None:
+        block = find_control_block(gdb, args.ram_start, args.ram_size)
+        if block is None:
+            # The firmware publishes the block on its first console access
+            gdb.resume()
+            time.sleep(0.1)
+            gdb.stop()
+    print("control block at 0x%08x" % block, file=sys.stderr)
+    if args.halt or not gdb.background():
+        print("halting the core for every read, see --help for the limits",
+              file=sys.stderr)
+
+    up = block + HEADER_SIZE
+    down = up + BUFFER_DESC.size
+    out = sys.stdout.buffer
+    received = 0
+    started = time.monotonic()
+    try:
+        while True:
+            gdb.stop()
+            _, buf, size, wr, rd, _ = BUFFER_DESC.unpack(gdb.read(up, BUFFER_DESC.size))
+            idle = wr == rd
+            if not idle:
+                if wr > rd:
+                    data = gdb.read(buf + rd, wr - rd)
+                else:
+                    data = gdb.read(buf + rd, size - rd) + gdb.read(buf, wr)
+                gdb.write(up + 16, struct.pack("<I", wr))
+                out.write(data)
+                out.flush()
+                received += len(data)
+
+            if select.select([sys.stdin], [], [], 0)[0]:
+                line = os.read(sys.stdin.fileno(), 256)
+                _, buf, size, wr, rd, _ = BUFFER_DESC.unpack(
+                    gdb.read(down, BUFFER_DESC.size))
+                for byte in line:
+                    if (wr + 1) % size == rd:
+                        break  # drop what the target has no room for
+                    gdb.write(buf + wr, bytes([byte]))
+                    wr = (wr + 1) % size
+                gdb.write(down + 12, struct.pack("<I", wr))
+
+            gdb.resume()
+            # Drain a busy buffer back to back, only wait while it is empty
+            if idle:
+                time.sleep(args.interval)
+    except KeyboardInterrupt:
+        gdb.resume()
+        elapsed = time.monotonic() - started
+        print("%d bytes in %.1f s, %.1f KB/s" % (received, elapsed,
+                                                   received / elapsed / 1024),
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+Per-symbol flash and RAM use against a stored baseline.
+
+Symbol sizes come from the ELF symbol table, grouped by the output section
+they live in. String literals and merged constants have no symbols, their
+input sections are taken from the linker map instead and attributed to
+the object file that contributed them.
+
+    tools/size_diff.py snapshot app.elf app.map > tools/size_baseline.json
+    tools/size_diff.py diff app.elf app.map tools/size_baseline.json
+
+`diff` prints the largest changes per section and fails if any of .text,
+.ram_code (flash and RAM), .rodata, .data or .bss grew by more than
+--threshold bytes. A function moved to SRAM leaves .text and shows up
+under .ram_code.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+SECTIONS = (".text", ".ram_code", ".rodata", ".data", ".bss")
+# Input sections that carry no symbol of their own: .rodata.str1.4, or with
+# -ffunction-sections/-fdata-sections .rodata.<function>.str1.4
+ANONYMOUS = re.compile(r"^\.rodata(\.\S+)?\.((?:str|cst)\d+)")
+INPUT_LINE = re.compile(r"^ (\.\S+)(?:\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S.*))?$")
+ADDRESS_LINE = re.compile(r"^\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S.*)$")
+
+
+def elf_symbols(readelf, elf):
+    sections = {}
+    for line in subprocess.check_output([readelf, "-SW", elf], text=True).splitlines():
+        match = re.match(r"^\s*\[\s*(\d+)\]\s+(\S+)", line)
+        if match:
+            sections[match.group(1)] = match.group(2)
+
+    sizes = {}
+    for line in subprocess.check_output([readelf, "-sW", elf], text=True).splitlines():
+        # Num: Value Size Type Bind Vis Ndx Name
+        fields = line.split()
+        if len(fields) < 8 or not fields[0].endswith(":"):
+            continue
+        size, kind, index, name = fields[2], fields[3], fields[6], fields[7]
+        if kind not in ("FUNC", "OBJECT") or index not in sections:
+            continue
+        size = int(size, 0)
+        if size:
+            section = sizes.setdefault(sections[index], {})
+            section[name] = section.get(name, 0) + size
+    return sizes
+
+
+def map_anonymous(map_file):
+    sizes = {}
+    output = None
+    pending = None
+    with open(map_file) as lines:
+        for line in lines:
+            line = line.rstrip("\n")
+            if line.startswith("."):
+                output = line.split()[0]
+                continue
+            if pending is not None:
+                match = ADDRESS_LINE.match(line)
+                if match:
+                    add_input(sizes, output, pending, match.group(2), match.group(3))
+                pending = None
+                continue
+            match = INPUT_LINE.match(line)
+            if match and ANONYMOUS.match(match.group(1)):
+                if match.group(2) is None:
+                    pending = match.group(1)
+                else:
+                    add_input(sizes, output, match.group(1), match.group(3),
+                              match.group(4))
+    return sizes
+
+
+def add_input(sizes, output, name, size, origin):
+    size = int(size, 16)
+    if output is None or not size:
+        return
+    # Per kind and object, literals move between functions
+    key = "%s(%s)" % (ANONYMOUS.match(name).group(2), os.path.basename(origin.strip()))
+    section = sizes.setdefault(output, {})
+    section[key] = section.get(key, 0) + size
+
+
+def snapshot(args):
+    sizes = elf_symbols(args.readelf, args.elf)
+    for section, symbols in map_anonymous(args.map).items():
+        sizes.setdefault(section, {}).update(symbols)
+    return sizes
+
+
+def diff(args, current):
+    with open(args.baseline) as baseline_file:
+        baseline = json.load(baseline_file)
+
+    failed = False
+    for section in SECTIONS:
+        old = baseline.get(section, {})
+        new = current.get(section, {})
+        total = sum(new.values()) - sum(old.values())
+        changes = sorted(
+            ((new.get(name, 0) - old.get(name, 0), name) for name in set(old) | set(new)),
+            key=lambda change: -abs(change[0]))
+        changes = [change for change in changes if change[0]][:args.top]
+
+        over = total > args.threshold
+        failed |= over
+        print("%-9s %+7d bytes%s" % (section, total,
+                                       "  over threshold %d" % args.threshold if over else ""))
+        for delta, name in changes:
+            state = "new" if name not in old else "gone" if name not in new else ""
+            print("    %+7d  %s %s" % (delta, name, state))
+    return failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("command", choices=("snapshot", "diff"))
+    parser.add_argument("elf")
+    parser.add_argument("map")
+    parser.add_argument("baseline", nargs="?")
+    parser.add_argument("--readelf", default="arm-none-eabi-readelf")
+    parser.add_argument("--threshold", type=int, default=0,
+                        help="allowed growth per section in bytes")
+    parser.add_argument("--top", type=int, default=10,
+                        help="changes listed per section")
+    parser.add_argument("--output", help="snapshot file, stdout if omitted")
+    args = parser.parse_args()
+
+    current = snapshot(args)
+    if args.command == "snapshot":
+        text = json.dumps(current, indent=1, sort_keys=True) + "\n"
+        if args.output:
+            with open(args.output, "w") as output:
+                output.write(text)
+        else:
+            sys.stdout.write(text)
+        return 0
+
+    if args.baseline is None or not os.path.exists(args.baseline):
+        print("no baseline at %s, create one with the size-baseline target"
+              % args.baseline, file=sys.stderr)
+        return 1
+    return 1 if diff(args, current) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""
+Worst-case stack depth from GCC's -fcallgraph-info=su output.
+
+Every .ci file under the build directory contributes its functions (frame
+size from the stack usage analysis) and call edges. Entry points are
+Reset_Handler, which reaches main(), and every handler in Vector_Table of
+bootloader.c. All of them run on the main stack, so the worst case is the
+deepest Reset_Handler path plus, for every priority level that can preempt
+it, the deepest handler of that level and one exception frame each.
+
+    tools/stack_analysis.py --build-dir build --priority USART2_IRQHandler=5
+
+Configurable exceptions default to priority 0 (the reset value), so they
+cannot preempt one another. NMI and HardFault preempt everything.
+"""
+
+import argparse
+import glob
+import os
+import re
+import sys
+
+NODE = re.compile(r'node: \{ title: "([^"]+)" label: "([^"]*)"(.*)\}')
+EDGE = re.compile(r'edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+FRAME = re.compile(r"\\n(\d+) bytes \(([^)]*)\)")
+INDIRECT = "__indirect_call"
+
+FIXED_PRIORITY = {"Reset_Handler": None, "NMI_Handler": -2, "HardFault_Handler": -1}
+# Exception entry with the FPU context stacked: 26 words plus alignment
+EXCEPTION_FRAME = 26 * 4 + 4
+
+
+class Function:
+    def __init__(self, name, source, frame, kind):
+        self.name = name
+        self.source = source
+        self.frame = frame
+        self.kind = kind
+        # Callee names, and the functions defined next to this one, which
+        # take precedence since a static callee is not visible elsewhere
+        self.calls = []
+        self.siblings = {}
+
+
+def load_callgraph(build_dir):
+    # Weak defaults in bootloader.c lose against a definition elsewhere
+    functions = {}
+    for path in sorted(glob.glob(os.path.join(build_dir, "**", "*.ci"), recursive=True)):
+        edges = []
+        defined = {}
+        with open(path) as ci:
+            for line in ci:
+                node = NODE.search(line)
+                if node and "shape : ellipse" not in node.group(3):
+                    frame = FRAME.search(node.group(2))
+                    name = node.group(1)
+                    defined[name] = Function(
+                        name, os.path.basename(path),
+                        int(frame.group(1)) if frame else 0,
+                        frame.group(2) if frame else "unknown")
+                    continue
+                edge = EDGE.search(line)
+                if edge:
+                    edges.append((edge.group(1), edge.group(2)))
+        for name, function in defined.items():
+            function.siblings = defined
+            known = functions.get(name)
+            if known is None or known.source.startswith("bootloader"):
+                functions[name] = function
+        for source, target in edges:
+            caller = defined.get(source)
+            if caller is not None:
+                caller.calls.append(target)
+    return functions
+
+
+def depth(functions, function, notes, stack=()):
+    """
+    @return (bytes, call path) of the deepest path starting at `function`
+    """
+    if function in stack:
+        notes.add("recursion through %s, depth unbounded" % function.name)
+        return 0, [function.name + " (recursive)"]
+    if function.kind not in ("static", "dynamic,bounded"):
+        notes.add("%s has %s stack usage" % (function.name, function.kind))
+
+    deepest, path = 0, []
+    for name in function.calls:
+        if name == INDIRECT:
+            notes.add("indirect call in %s not followed" % function.name)
+            continue
+        callee = function.siblings.get(name) or functions.get(name)
+        if callee is None:
+            notes.add("no stack information for %s" % name)
+            continue
+        size, callee_path = depth(functions, callee, notes, stack + (function,))
+        if size > deepest:
+            deepest, path = size, callee_path
+    # Static functions are titled with their full source path
+    return function.frame + deepest, [os.path.basename(function.name)] + path
+
+
+def vector_handlers(bootloader):
+    with open(bootloader) as source:
+        text = source.read()
+    table = re.search(r"Vector_Table\[\]\)\(void\) = \{(.*?)\};", text, re.S)
+    return [name for name in re.findall(r"\b(\w+_(?:IRQ)?Handler)\b", table.group(1))]
+
+
+def min_stack_size(linker_script):
+    with open(linker_script) as script:
+        match = re.search(r"_Min_Stack_Size\s*=\s*(0x[0-9a-fA-F]+|\d+)", script.read())
+    return int(match.group(1), 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--build-dir", default=".")
+    parser.add_argument("--bootloader", default="src/bootloader.c")
+    parser.add_argument("--linker-script", default="src/STM32F446RETx_FLASH.ld")
+    parser.add_argument("--priority", action="append", default=[],
+                        metavar="HANDLER=LEVEL",
+                        help="NVIC priority of a handler, lower preempts higher")
+    args = parser.parse_args()
+
+    functions = load_callgraph(args.build_dir)
+    if not functions:
+        print("no .ci files under %s, build with -fcallgraph-info=su" % args.build_dir,
+              file=sys.stderr)
+        return 1
+
+    priorities = {}
+    for handler in vector_handlers(args.bootloader):
+        priorities[handler] = FIXED_PRIORITY.get(handler, 0)
+    for setting in args.priority:
+        handler, level = setting.split("=")
+        priorities[handler] = int(level)
+
+    notes = set()
+    results = {}
+    for handler in priorities:
+        if handler in functions:
+            results[handler] = depth(functions, functions[handler], notes)
+
+    print("entry point                       bytes  deepest path")
+    for handler, (size, path) in sorted(results.items(), key=lambda r: -r[1][0]):
+        print("%-32s %6d  %s" % (handler, size, " > ".join(path)))
+
+    # Thread mode, then the deepest handler of every level that preempts it
+    total, chain = results.get("Reset_Handler", (0, []))[0], ["Reset_Handler"]
+    levels = {}
+    for handler, level in priorities.items():
+        if level is not None and handler in results:
+            if results[handler][0] > levels.get(level, (0, None))[0]:
+                levels[level] = (results[handler][0], handler)
+    for level in sorted(levels, reverse=True):
+        size, handler = levels[level]
+        total += size + EXCEPTION_FRAME
+        chain.append("%s (priority %d)" % (handler, level))
+
+    limit = min_stack_size(args.linker_script)
+    print()
+    for note in sorted(notes):
+        print("note: " + note)
+    print()
+    print("worst case %d bytes: %s" % (total, " < ".join(chain)))
+    print("_Min_Stack_Size %d bytes: %s" % (limit, "ok" if total <= limit else "EXCEEDED"))
+    return 0 if total <= limit else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
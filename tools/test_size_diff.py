@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""
+Literal attribution of size_diff.py against fixtures/size_diff.map, which
+holds string and constant sections named both with and without the
+function (-ffunction-sections/-fdata-sections):
+
+    python3 -m unittest discover tools
+"""
+
+import argparse
+import json
+import os
+import sys
+import tempfile
+import unittest
+from contextlib import redirect_stdout
+from io import StringIO
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import size_diff  # noqa: E402
+
+FIXTURE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "fixtures", "size_diff.map")
+
+
+class LiteralTest(unittest.TestCase):
+    def test_both_naming_forms(self):
+        sizes = size_diff.map_anonymous(FIXTURE)
+        self.assertEqual(sizes, {".rodata": {
+            "str1(format.c.obj)": 0x58,
+            "str1(log.c.obj)": 0x30,
+            "cst4(main.c.obj)": 0x8,
+            "str1(libc_nano.a(libc_a-nano-vfprintf.o))": 0x1c,
+            "cst8(libc_nano.a(libc_a-dtoa.o))": 0x10,
+        }})
+
+    def test_grown_literal_fails(self):
+        current = size_diff.map_anonymous(FIXTURE)
+        baseline = {".rodata": dict(current[".rodata"])}
+        baseline[".rodata"]["str1(format.c.obj)"] -= 24
+        with tempfile.NamedTemporaryFile("w", suffix=".json", delete=False) as file:
+            json.dump(baseline, file)
+        try:
+            args = argparse.Namespace(baseline=file.name, threshold=0, top=10)
+            output = StringIO()
+            with redirect_stdout(output):
+                failed = size_diff.diff(args, current)
+        finally:
+            os.unlink(file.name)
+        self.assertTrue(failed)
+        self.assertIn(".rodata       +24 bytes", output.getvalue())
+        self.assertIn("+24  str1(format.c.obj)", output.getvalue())
+
+    def test_ram_code_checked(self):
+        # A function moved into SRAM that grew on the way
+        baseline = {".text": {"crc_software": 0x40}}
+        current = {".text": {}, ".ram_code": {"crc_software": 0x48}}
+        with tempfile.NamedTemporaryFile("w", suffix=".json", delete=False) as file:
+            json.dump(baseline, file)
+        try:
+            args = argparse.Namespace(baseline=file.name, threshold=0, top=10)
+            output = StringIO()
+            with redirect_stdout(output):
+                failed = size_diff.diff(args, current)
+        finally:
+            os.unlink(file.name)
+        self.assertTrue(failed)
+        self.assertIn(".text         -64 bytes", output.getvalue())
+        self.assertIn(".ram_code     +72 bytes  over threshold 0", output.getvalue())
+
+
+if __name__ == "__main__":
+    unittest.main()
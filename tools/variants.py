@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+Builds the benchmark firmware for every optimization profile.
+
+Each profile is configured in its own build directory with BENCHMARK,
+BOOT_BENCH and SEMIHOSTING enabled, sized with arm-none-eabi-size and run through the
+test-qemu target, which fails on a failed check or a hung image. The table lists flash (text + data) and RAM (data + bss)
+next to the median cycles of every benchmark, so speed can be weighed
+against size. With --cxx every profile is built a second time with the
+C++ runtime and benchmarks (CPLUSPLUS) to show their cost against plain C,
+the ctors column counts the constructors Reset_Handler runs at boot.
+With --core the profiles are built for each listed core variant (M4, M7,
+M33), and the boot column compares the startup of the cores.
+
+    tools/variants.py --source . --build build/variants
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+PROFILES = [
+    ("Release", "OFF"),
+    ("Release", "ON"),
+    ("Speed", "OFF"),
+    ("Speed", "ON"),
+    ("Fast", "OFF"),
+    ("Fast", "ON"),
+]
+
+PROJECT = "stm32-boot-explained"
+
+
+def run(cmd, capture=False):
+    result = subprocess.run(cmd, check=True, text=True,
+                            stdout=subprocess.PIPE if capture else None)
+    return result.stdout
+
+
+def build(args, core, build_type, lto, cxx):
+    name = "%s-%s%s%s" % (core, build_type, "-lto" if lto == "ON" else "",
+                          "-cxx" if cxx == "ON" else "")
+    directory = os.path.join(args.build, name)
+    run(["cmake", "-S", args.source, "-B", directory, "-DCORE=" + core,
+         "-DCMAKE_BUILD_TYPE=" + build_type, "-DLTO=" + lto,
+         "-DCPLUSPLUS=" + cxx, "-DBOOT_BENCH=ON",
+         "-DBENCHMARK=ON", "-DSEMIHOSTING=ON", "-DQEMU=" + args.qemu],
+        capture=True)
+    run(["cmake", "--build", directory, "-j", str(os.cpu_count() or 1)],
+        capture=True)
+    return name, directory
+
+
+def sizes(args, directory):
+    elf = os.path.join(directory, PROJECT + ".elf")
+    # text data bss dec hex filename
+    fields = run([args.size, elf], capture=True).splitlines()[1].split()
+    text, data, bss = (int(v) for v in fields[:3])
+    # section size addr, one per line
+    ctors = 0
+    for line in run([args.size, "-A", elf], capture=True).splitlines():
+        fields = line.split()
+        if fields and fields[0] in (".preinit_array", ".init_array"):
+            ctors += int(fields[1]) // 4
+    return text + data, data + bss, ctors
+
+
+def benchmarks(directory):
+    output = run(["cmake", "--build", directory, "--target", "test-qemu"],
+                 capture=True)
+    results = {}
+    for line in output.splitlines():
+        line = line.strip()
+        if line.startswith("{"):
+            result = json.loads(line)
+            # The boot time line has a single count
+            results[result["bench"]] = result.get("median", result.get("cycles"))
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--source", default=".")
+    parser.add_argument("--build", default="variants")
+    parser.add_argument("--size", default="arm-none-eabi-size")
+    parser.add_argument("--qemu", default="qemu-system-arm")
+    parser.add_argument("--no-run", dest="execute", action="store_false",
+                        help="report sizes only, without QEMU")
+    parser.add_argument("--cxx", action="store_true",
+                        help="also build every profile with CPLUSPLUS")
+    parser.add_argument("--core", action="append",
+                        help="core variant to build for, repeatable (default M4)")
+    parser.add_argument("--build-type", action="append",
+                        help="only build these profiles, repeatable")
+    args = parser.parse_args()
+
+    rows = []
+    names = []
+    variants = [(core, build_type, lto, cxx)
+                for core in args.core or ["M4"]
+                for build_type, lto in PROFILES
+                if not args.build_type or build_type in args.build_type
+                for cxx in (("OFF", "ON") if args.cxx else ("OFF",))]
+    for core, build_type, lto, cxx in variants:
+        name, directory = build(args, core, build_type, lto, cxx)
+        flash, ram, ctors = sizes(args, directory)
+        cycles = benchmarks(directory) if args.execute else {}
+        names += [bench for bench in cycles if bench not in names]
+        rows.append((name, flash, ram, ctors, cycles))
+        print("built %s" % name, file=sys.stderr)
+
+    header = ["variant", "flash", "ram", "ctors"] + names
+    table = [header] + [
+        [name, str(flash), str(ram), str(ctors)] +
+        [str(cycles.get(bench, "-")) for bench in names]
+        for name, flash, ram, ctors, cycles in rows
+    ]
+    widths = [max(len(row[i]) for row in table) for i in range(len(header))]
+    for row in table:
+        print("  ".join(cell.rjust(width) for cell, width in zip(row, widths)))
+
+
+if __name__ == "__main__":
+    main()